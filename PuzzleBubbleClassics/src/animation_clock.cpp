@@ -0,0 +1,129 @@
+#include "animation_clock.h"
+
+#include "utils/logger.h"
+#include "utils/profiler.h"
+
+#include <algorithm>
+
+
+AnimationClock AnimationClock::Instance;
+
+
+TimerWheel::TimerWheel(const sf::Time& resolution, std::size_t slotCount) :
+	_resolution(std::max(resolution, sf::microseconds(1))),
+	_slots(std::max<std::size_t>(slotCount, 1))
+{}
+
+TimerId TimerWheel::scheduleAt(const sf::Time& deadline, Callback callback)
+{
+	// Never in the tick being processed, so a timer scheduled from a callback fires on a later advance. //
+	const Int64 tick = std::max(tickOf(deadline), _tick + 1);
+
+	const TimerId id = _nextId++;
+	_timers.insert({ id, { deadline, tick, std::move(callback) } });
+	slotOf(tick).push_back(id);
+	return id;
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+	// The id stays in its bucket and is skipped when the bucket comes round. //
+	return _timers.erase(id) > 0;
+}
+
+void TimerWheel::advance(const sf::Time& time)
+{
+	PROFILE_ZONE("TimerWheel::advance");
+
+	const Int64 last = time.asMicroseconds() / _resolution.asMicroseconds();
+	for (; _tick < last; )
+	{
+		++_tick;
+
+		std::vector<TimerId>& slot = slotOf(_tick);
+		_expired.clear();
+		std::erase_if(slot, [this](TimerId id) {
+			auto it = _timers.find(id);
+			if (it == _timers.end())
+				return true;
+			if (it->second.tick != _tick)
+				return false;
+
+			_expired.push_back(id);
+			return true;
+		});
+
+		// Slots are not ordered, ties inside a tick fire by deadline and then by scheduling order. //
+		std::sort(_expired.begin(), _expired.end(), [this](TimerId left, TimerId right) {
+			const sf::Time& leftDeadline = _timers.at(left).deadline;
+			const sf::Time& rightDeadline = _timers.at(right).deadline;
+			return leftDeadline != rightDeadline ? leftDeadline < rightDeadline : left < right;
+		});
+
+		for (TimerId id : _expired)
+		{
+			auto it = _timers.find(id);
+			if (it == _timers.end())
+				continue;
+
+			Timer timer = std::move(it->second);
+			_timers.erase(it);
+			_time = std::max(_time, timer.deadline);
+			timer.callback(timer.deadline);
+		}
+	}
+
+	_time = std::max(_time, time);
+}
+
+void TimerWheel::clear()
+{
+	for (auto& slot : _slots)
+		slot.clear();
+	_timers.clear();
+}
+
+void TimerWheel::reset()
+{
+	clear();
+	_time = sf::Time::Zero;
+	_tick = 0;
+}
+
+
+
+void AnimationClock::advance(const sf::Time& elapsedTime)
+{
+	_now += elapsedTime;
+	_timers.advance(_now);
+}
+
+TimerId AnimationClock::schedule(const sf::Time& delay, TimerWheel::Callback callback)
+{
+	if (!checkOwnerThread("schedule"))
+		return InvalidTimer;
+	return _timers.schedule(delay, std::move(callback));
+}
+
+TimerId AnimationClock::scheduleAt(const sf::Time& deadline, TimerWheel::Callback callback)
+{
+	if (!checkOwnerThread("schedule"))
+		return InvalidTimer;
+	return _timers.scheduleAt(deadline, std::move(callback));
+}
+
+bool AnimationClock::cancel(TimerId id)
+{
+	if (id == InvalidTimer || !checkOwnerThread("cancel"))
+		return false;
+	return _timers.cancel(id);
+}
+
+bool AnimationClock::checkOwnerThread(std::string_view operation) const
+{
+	if (std::this_thread::get_id() == _owner)
+		return true;
+
+	logger::error("AnimationClock: Cannot {} a timer outside the update thread.", operation);
+	return false;
+}
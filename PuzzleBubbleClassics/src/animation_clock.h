@@ -0,0 +1,144 @@
+#pragma once
+
+#include "utils/rawtypes.h"
+
+#include <SFML/System.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+using TimerId = Uint64;
+
+static constexpr TimerId InvalidTimer = 0;
+
+
+/*
+	Hashed timer wheel. Timers are bucketed by their deadline tick, so advancing only visits the
+	buckets of the elapsed ticks; timers further away than one turn stay in their bucket until their
+	round comes. Callbacks receive the exact deadline and may schedule or cancel timers.
+*/
+class TimerWheel
+{
+public:
+	using Callback = std::function<void(const sf::Time&)>;
+
+	static constexpr std::size_t DefaultSlotCount = 256;
+	static inline const sf::Time DefaultResolution = sf::milliseconds(10);
+
+private:
+	struct Timer
+	{
+		sf::Time deadline;
+		Int64 tick;
+		Callback callback;
+	};
+
+private:
+	sf::Time _resolution;
+	std::vector<std::vector<TimerId>> _slots;
+	std::unordered_map<TimerId, Timer> _timers;
+
+	// Timers of the tick being processed, kept to reuse its storage. //
+	std::vector<TimerId> _expired;
+	sf::Time _time;
+	Int64 _tick = 0;
+	TimerId _nextId = InvalidTimer + 1;
+
+public:
+	explicit TimerWheel(const sf::Time& resolution = DefaultResolution, std::size_t slotCount = DefaultSlotCount);
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel(TimerWheel&&) noexcept = default;
+	~TimerWheel() = default;
+
+	TimerWheel& operator= (const TimerWheel&) = delete;
+	TimerWheel& operator= (TimerWheel&&) noexcept = default;
+
+public:
+	inline TimerId schedule(const sf::Time& delay, Callback callback) { return scheduleAt(_time + std::max(delay, sf::Time::Zero), std::move(callback)); }
+
+	// Deadlines already past fire on the next tick. //
+	TimerId scheduleAt(const sf::Time& deadline, Callback callback);
+	bool cancel(TimerId id);
+
+	// Fires every timer due up to 'time', in deadline order. //
+	void advance(const sf::Time& time);
+
+	void clear();
+
+	// Drops every timer and restarts at time zero. Ids keep counting, so stale ones never match a new timer. //
+	void reset();
+
+public:
+	constexpr const sf::Time& getTime() const { return _time; }
+	constexpr const sf::Time& getResolution() const { return _resolution; }
+
+	inline std::size_t size() const { return _timers.size(); }
+	inline bool contains(TimerId id) const { return _timers.contains(id); }
+
+private:
+	inline Int64 tickOf(const sf::Time& time) const { return (time.asMicroseconds() + _resolution.asMicroseconds() - 1) / _resolution.asMicroseconds(); }
+	inline std::vector<TimerId>& slotOf(Int64 tick) { return _slots[std::size_t(tick) % _slots.size()]; }
+};
+
+
+
+/*
+	Game time shared by every animation. It advances once per fixed step, so animated sprites only
+	store when they started and resolve their frame when drawn, and replays see the same frames.
+	Timers belong to the thread that created the clock, the update thread: scheduling or cancelling
+	from any other one is refused with an error. Frame requests may come from any thread.
+*/
+class AnimationClock
+{
+private:
+	static AnimationClock Instance;
+
+private:
+	sf::Time _now;
+	TimerWheel _timers;
+	std::atomic<bool> _frameRequested = false;
+	std::thread::id _owner = std::this_thread::get_id();
+
+public:
+	AnimationClock(const AnimationClock&) = delete;
+	AnimationClock(AnimationClock&&) noexcept = delete;
+	~AnimationClock() = default;
+
+	AnimationClock& operator= (const AnimationClock&) = delete;
+	AnimationClock& operator= (AnimationClock&&) noexcept = delete;
+
+public:
+	void advance(const sf::Time& elapsedTime);
+
+	// Back to time zero without timers, for replays that rebuild their activities. //
+	inline void reset() { _now = sf::Time::Zero, _timers.reset(); }
+
+public:
+	inline const sf::Time& now() const { return _now; }
+
+	// InvalidTimer when called off the update thread. //
+	TimerId schedule(const sf::Time& delay, TimerWheel::Callback callback);
+	TimerId scheduleAt(const sf::Time& deadline, TimerWheel::Callback callback);
+	bool cancel(TimerId id);
+
+	inline const TimerWheel& getTimers() const { return _timers; }
+
+	// Playing animations ask for one more frame each time they are drawn, the controller consumes it once per update. //
+	inline void requestFrame() { _frameRequested.store(true, std::memory_order_relaxed); }
+	inline bool consumeFrameRequest() { return _frameRequested.exchange(false, std::memory_order_relaxed); }
+
+private:
+	AnimationClock() = default;
+
+	bool checkOwnerThread(std::string_view operation) const;
+
+public:
+	static constexpr AnimationClock& instance() { return Instance; }
+};
@@ -0,0 +1,419 @@
+#include "archive.h"
+
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace resources
+{
+	MappedFile::MappedFile(MappedFile&& other) noexcept :
+		_data(std::exchange(other._data, nullptr)),
+		_size(std::exchange(other._size, 0))
+	{}
+
+	MappedFile& MappedFile::operator= (MappedFile&& right) noexcept
+	{
+		if (this != std::addressof(right))
+		{
+			close();
+			_data = std::exchange(right._data, nullptr);
+			_size = std::exchange(right._size, 0);
+		}
+		return *this;
+	}
+
+	bool MappedFile::open(const Path& path)
+	{
+		close();
+
+#ifdef _WIN32
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (mapping == nullptr)
+			return false;
+
+		// The view keeps the mapping object alive on its own. //
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (view == nullptr)
+			return false;
+
+		_data = static_cast<const std::byte*>(view);
+		_size = std::size_t(size.QuadPart);
+#else
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size <= 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		void* view = mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED)
+			return false;
+
+		_data = static_cast<const std::byte*>(view);
+		_size = std::size_t(info.st_size);
+#endif
+
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (_data == nullptr)
+			return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(_data);
+#else
+		munmap(const_cast<std::byte*>(_data), _size);
+#endif
+
+		_data = nullptr;
+		_size = 0;
+	}
+}
+
+
+
+namespace resources
+{
+	static std::string entryKey(std::string_view path)
+	{
+		std::string key = Path(path).lexically_normal().generic_string();
+		std::transform(key.begin(), key.end(), key.begin(), [](char c) { return char(std::tolower(static_cast<unsigned char>(c))); });
+		return key;
+	}
+
+	template <typename _Ty>
+	static bool readValue(std::span<const std::byte> data, Uint64& offset, _Ty& value)
+	{
+		if (offset > data.size() || data.size() - offset < sizeof(_Ty))
+			return false;
+
+		std::memcpy(std::addressof(value), data.data() + offset, sizeof(_Ty));
+		offset += sizeof(_Ty);
+		return true;
+	}
+
+	static bool readLength(const Uint8*& ip, const Uint8* const iend, std::size_t& length)
+	{
+		Uint8 byte;
+		do
+		{
+			if (ip >= iend)
+				return false;
+			byte = *ip++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	static bool decompressLZ4(std::span<const std::byte> src, std::span<std::byte> dst)
+	{
+		const Uint8* ip = reinterpret_cast<const Uint8*>(src.data());
+		const Uint8* const iend = ip + src.size();
+		Uint8* const obegin = reinterpret_cast<Uint8*>(dst.data());
+		Uint8* op = obegin;
+		Uint8* const oend = op + dst.size();
+
+		while (ip < iend)
+		{
+			const Uint8 token = *ip++;
+
+			std::size_t literals = token >> 4;
+			if (literals == 15 && !readLength(ip, iend, literals))
+				return false;
+			if (literals > std::size_t(iend - ip) || literals > std::size_t(oend - op))
+				return false;
+
+			std::memcpy(op, ip, literals);
+			ip += literals;
+			op += literals;
+
+			// Last sequence has literals only. //
+			if (ip >= iend)
+				break;
+
+			if (iend - ip < 2)
+				return false;
+			const std::size_t offset = std::size_t(ip[0]) | (std::size_t(ip[1]) << 8);
+			ip += 2;
+			if (offset == 0 || offset > std::size_t(op - obegin))
+				return false;
+
+			std::size_t match = token & 15;
+			if (match == 15 && !readLength(ip, iend, match))
+				return false;
+			match += 4;
+			if (match > std::size_t(oend - op))
+				return false;
+
+			// Matches may overlap their own output, so they are copied forward byte by byte. //
+			const Uint8* ref = op - offset;
+			for (std::size_t i = 0; i < match; ++i)
+				op[i] = ref[i];
+			op += match;
+		}
+
+		return op == oend;
+	}
+
+
+
+	bool Archive::open(const Path& path)
+	{
+		_entries.clear();
+		_lookup.clear();
+		_decompressed.clear();
+		_path = utils::path::absolute(path);
+
+		if (!_file.open(path))
+		{
+			logger::error("Archive '{}': Cannot map file.", path.string());
+			return false;
+		}
+
+		const std::span<const std::byte> data = _file.span();
+		Uint64 offset = 0;
+
+		std::array<char, 4> magic;
+		Uint32 version = 0, count = 0, reserved = 0;
+		Uint64 tocOffset = 0, tocSize = 0;
+		if (!readValue(data, offset, magic) || magic != Magic
+			|| !readValue(data, offset, version) || !readValue(data, offset, count) || !readValue(data, offset, reserved)
+			|| !readValue(data, offset, tocOffset) || !readValue(data, offset, tocSize))
+		{
+			logger::error("Archive '{}': Invalid header.", path.string());
+			_file.close();
+			return false;
+		}
+
+		if (version != Version)
+		{
+			logger::error("Archive '{}': Unsupported version {}. Expected {}.", path.string(), version, Version);
+			_file.close();
+			return false;
+		}
+
+		if (tocOffset > data.size() || data.size() - tocOffset < tocSize)
+		{
+			logger::error("Archive '{}': Table of contents out of bounds.", path.string());
+			_file.close();
+			return false;
+		}
+
+		const std::span<const std::byte> toc = data.subspan(std::size_t(tocOffset), std::size_t(tocSize));
+		offset = 0;
+		_entries.reserve(count);
+		for (Uint32 i = 0; i < count; ++i)
+		{
+			ArchiveEntry entry;
+			Uint32 compression = 0, pathLength = 0;
+			if (!readValue(toc, offset, entry.offset) || !readValue(toc, offset, entry.size) || !readValue(toc, offset, entry.storedSize)
+				|| !readValue(toc, offset, compression) || !readValue(toc, offset, pathLength) || toc.size() - offset < pathLength)
+			{
+				logger::error("Archive '{}': Truncated table of contents at entry {}.", path.string(), i);
+				_entries.clear();
+				_file.close();
+				return false;
+			}
+
+			entry.path = Path(std::string_view(reinterpret_cast<const char*>(toc.data() + offset), pathLength)).lexically_normal().generic_string();
+			offset += (Uint64(pathLength) + 7) & ~Uint64(7);
+			entry.compression = ArchiveCompression(compression);
+
+			const bool inBounds = entry.offset <= data.size() && data.size() - entry.offset >= entry.storedSize;
+			const bool validCompression = entry.compression == ArchiveCompression::LZ4
+				|| (entry.compression == ArchiveCompression::None && entry.size == entry.storedSize);
+			if (!inBounds || !validCompression || entry.offset % Alignment != 0 || entry.path.empty())
+			{
+				logger::warn("Archive '{}': Skipping invalid entry '{}'.", path.string(), entry.path);
+				continue;
+			}
+
+			_lookup.insert_or_assign(entryKey(entry.path), _entries.size());
+			_entries.push_back(std::move(entry));
+		}
+
+		return true;
+	}
+
+	const ArchiveEntry* Archive::findEntry(std::string_view path) const
+	{
+		auto it = _lookup.find(entryKey(path));
+		if (it == _lookup.end())
+			return nullptr;
+		return std::addressof(_entries[it->second]);
+	}
+
+	std::optional<std::span<const std::byte>> Archive::read(const ArchiveEntry& entry) const
+	{
+		const std::span<const std::byte> stored = _file.span().subspan(std::size_t(entry.offset), std::size_t(entry.storedSize));
+		if (entry.compression == ArchiveCompression::None)
+			return stored;
+
+		std::scoped_lock lock(_cacheMutex);
+		auto it = _decompressed.find(std::addressof(entry));
+		if (it != _decompressed.end())
+			return std::span<const std::byte>(*it->second);
+
+		auto buffer = std::make_unique<std::vector<std::byte>>(std::size_t(entry.size));
+		if (!decompressLZ4(stored, *buffer))
+		{
+			logger::error("Archive '{}': Corrupted compressed entry '{}'.", _path.string(), entry.path);
+			return {};
+		}
+
+		return std::span<const std::byte>(*_decompressed.emplace(std::addressof(entry), std::move(buffer)).first->second);
+	}
+
+	JsonValue Archive::readJson(std::string_view path) const
+	{
+		const auto data = read(path);
+		if (!data.has_value())
+			return {};
+
+		try { return json::parse(std::string_view(reinterpret_cast<const char*>(data->data()), data->size())); }
+		catch (const JsonValue::exception& ex)
+		{
+			logger::error("Archive '{}': Malformed json '{}'. {}", _path.string(), path, ex.what());
+			return {};
+		}
+	}
+
+	void Archive::forEachEntry(std::string_view directory, const std::function<void(const ArchiveEntry&, std::string_view)>& action) const
+	{
+		const std::string prefix = directory.empty() ? std::string() : entryKey(directory) + '/';
+		for (const auto& entry : _entries)
+		{
+			const std::string key = entryKey(entry.path);
+			if (key.size() > prefix.size() && key.starts_with(prefix))
+				action(entry, std::string_view(entry.path).substr(prefix.size()));
+		}
+	}
+
+	template <typename _Ty>
+	static void writeValue(std::ostream& os, const _Ty& value)
+	{
+		os.write(reinterpret_cast<const char*>(std::addressof(value)), sizeof(_Ty));
+	}
+
+	static void writePadding(std::ostream& os, Uint64 alignment)
+	{
+		static constexpr std::array<char, Archive::Alignment> zeros = {};
+		const Uint64 position = Uint64(os.tellp());
+		const Uint64 padding = (alignment - position % alignment) % alignment;
+		os.write(zeros.data(), std::streamsize(padding));
+	}
+
+	bool Archive::pack(const Path& directory, const Path& output)
+	{
+		namespace fs = std::filesystem;
+
+		if (!utils::path::isDirectory(directory))
+		{
+			logger::error("Archive pack: Expected valid directory, but found '{}'.", directory.string());
+			return false;
+		}
+
+		std::vector<ArchiveEntry> entries;
+		std::error_code ec;
+		for (auto it = fs::recursive_directory_iterator(directory, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+			if (it->is_regular_file(ec))
+				entries.push_back({ .path = it->path().lexically_relative(directory).generic_string() });
+
+		std::ofstream os(output, std::ios::binary);
+		if (!os)
+		{
+			logger::error("Archive pack: Cannot open '{}' file.", output.string());
+			return false;
+		}
+
+		// Header is rewritten at the end, once the table of contents position is known. //
+		const Uint32 reserved = 0;
+		const Uint32 count = Uint32(entries.size());
+		os.write(Magic.data(), Magic.size());
+		writeValue(os, Version);
+		writeValue(os, count);
+		writeValue(os, reserved);
+		writeValue(os, Uint64(0));
+		writeValue(os, Uint64(0));
+
+		for (auto& entry : entries)
+		{
+			std::ifstream is(directory / Path(entry.path), std::ios::binary);
+			if (!is)
+			{
+				logger::error("Archive pack: Cannot read '{}' file.", entry.path);
+				return false;
+			}
+
+			writePadding(os, Alignment);
+			entry.offset = Uint64(os.tellp());
+
+			// Streaming an empty buffer sets failbit on the output, empty files just take no bytes. //
+			if (is.peek() != std::ifstream::traits_type::eof())
+				os << is.rdbuf();
+			if (!os)
+			{
+				logger::error("Archive pack: Cannot write '{}' file into the archive.", entry.path);
+				return false;
+			}
+			entry.size = entry.storedSize = Uint64(os.tellp()) - entry.offset;
+		}
+
+		writePadding(os, 8);
+		const Uint64 tocOffset = Uint64(os.tellp());
+		for (const auto& entry : entries)
+		{
+			writeValue(os, entry.offset);
+			writeValue(os, entry.size);
+			writeValue(os, entry.storedSize);
+			writeValue(os, Uint32(entry.compression));
+			writeValue(os, Uint32(entry.path.size()));
+			os.write(entry.path.data(), std::streamsize(entry.path.size()));
+			writePadding(os, 8);
+		}
+		const Uint64 tocSize = Uint64(os.tellp()) - tocOffset;
+
+		os.seekp(Magic.size() + sizeof(Uint32) * 3);
+		writeValue(os, tocOffset);
+		writeValue(os, tocSize);
+
+		return bool(os);
+	}
+}
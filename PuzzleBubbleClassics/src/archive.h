@@ -0,0 +1,127 @@
+#pragma once
+
+#include "utils/path.h"
+#include "utils/json.h"
+#include "utils/rawtypes.h"
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace resources
+{
+	class MappedFile
+	{
+	private:
+		const std::byte* _data = nullptr;
+		std::size_t _size = 0;
+
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		inline ~MappedFile() { close(); }
+
+		MappedFile& operator= (const MappedFile&) = delete;
+		MappedFile& operator= (MappedFile&& right) noexcept;
+
+	public:
+		bool open(const Path& path);
+		void close();
+
+		constexpr bool isOpen() const { return _data != nullptr; }
+
+		constexpr const std::byte* data() const { return _data; }
+		constexpr std::size_t size() const { return _size; }
+
+		constexpr std::span<const std::byte> span() const { return { _data, _size }; }
+	};
+
+
+
+	enum class ArchiveCompression : Uint32
+	{
+		None = 0,
+		LZ4 = 1
+	};
+
+	struct ArchiveEntry
+	{
+		std::string path;
+		Uint64 offset = 0;
+		Uint64 size = 0;
+		Uint64 storedSize = 0;
+		ArchiveCompression compression = ArchiveCompression::None;
+	};
+
+
+	/*
+		Single file package, mapped in memory on open. Layout (little endian):
+			header: magic "PBCA", u32 version, u32 entry count, u32 reserved, u64 toc offset, u64 toc size
+			toc entry: u64 offset, u64 size, u64 stored size, u32 compression, u32 path length, path bytes padded to 8
+		Entry data starts at Alignment boundaries. Compressed entries use the raw LZ4 block format.
+	*/
+	class Archive
+	{
+	public:
+		static constexpr std::array<char, 4> Magic = { 'P', 'B', 'C', 'A' };
+		static constexpr Uint32 Version = 1;
+		static constexpr Uint64 Alignment = 16;
+		static constexpr std::string_view Extension = ".pbca";
+
+	private:
+		Path _path;
+		MappedFile _file;
+		std::vector<ArchiveEntry> _entries;
+		std::unordered_map<std::string, std::size_t> _lookup;
+
+		mutable std::mutex _cacheMutex;
+		mutable std::unordered_map<const ArchiveEntry*, std::unique_ptr<std::vector<std::byte>>> _decompressed;
+
+	public:
+		Archive() = default;
+		Archive(const Archive&) = delete;
+		Archive(Archive&&) noexcept = delete;
+		~Archive() = default;
+
+		Archive& operator= (const Archive&) = delete;
+		Archive& operator= (Archive&&) noexcept = delete;
+
+	public:
+		bool open(const Path& path);
+
+		inline const Path& path() const { return _path; }
+
+		constexpr bool isOpen() const { return _file.isOpen(); }
+
+		inline const std::vector<ArchiveEntry>& entries() const { return _entries; }
+
+		const ArchiveEntry* findEntry(std::string_view path) const;
+
+		// Uncompressed entries are returned as views into the mapping; compressed ones are decoded once and kept. //
+		std::optional<std::span<const std::byte>> read(const ArchiveEntry& entry) const;
+
+		JsonValue readJson(std::string_view path) const;
+
+		void forEachEntry(std::string_view directory, const std::function<void(const ArchiveEntry&, std::string_view)>& action) const;
+
+		inline std::optional<std::span<const std::byte>> read(std::string_view path) const
+		{
+			const ArchiveEntry* entry = findEntry(path);
+			if (entry == nullptr)
+				return {};
+			return read(*entry);
+		}
+
+	public:
+		// Packs every file below 'directory' uncompressed. Compressed entries come from external LZ4 block tools. //
+		static bool pack(const Path& directory, const Path& output);
+	};
+}
@@ -6,6 +6,8 @@
 void ArrowTextures::init(const Arrow& arrow)
 {
 	_arrow = std::addressof(arrow);
+
+	TextureManager::ImageCacheScope imageScope;
 	_texture = loadSprite("arrow.arrow", "arrow/arrow.png");
 	_base = loadSprite("arrow.arrow", "arrow/arrow.png");
 	_base2 = loadSprite("arrow.arrow", "arrow/arrow.png");
@@ -56,7 +58,12 @@ void ArrowTextures::init(const Arrow& arrow)
 
 void ArrowTextures::drawBase(sf::RenderTarget& canvas, sf::RenderStates rs)
 {
-	// TODO //
+	rs.transform *= getTransform();
+
+	// Gears sit between the two base halves, the lever goes over everything. //
+	for (const Sprite* sprite : { &_base2, &_gears[0], &_gears[1], &_gears[2], &_base, &_lever })
+		if (sprite->isValid())
+			canvas.draw(*sprite, rs);
 }
 
 void ArrowTextures::drawArrow(sf::RenderTarget& canvas, sf::RenderStates rs)
@@ -64,20 +71,28 @@ void ArrowTextures::drawArrow(sf::RenderTarget& canvas, sf::RenderStates rs)
 	// TODO //
 }
 
+void ArrowTextures::turnGears(float degrees)
+{
+	for (std::size_t i = 0; i < 3; ++i)
+		if (_gears[i].isValid())
+			_gears[i].rotate(i % 2 == 0 ? degrees : -degrees);
+}
+
 Sprite ArrowTextures::loadSprite(std::string_view textureKey, std::string_view textureFilename)
 {
-	auto texture = TextureManager::instance().get(textureKey.data());
-	if (texture == nullptr)
+	auto region = TextureManager::instance().getRegion(textureKey);
+	if (!region.isValid())
 	{
-		if (!TextureManager::instance().load(Path(textureFilename), textureKey.data()))
+		if (!TextureManager::instance().load(Path(textureFilename), std::string(textureKey)))
 		{
 			logger::error("Cannot load '{}' scenario.arrow texture.", textureFilename);
 			return Sprite();
 		}
-		texture = TextureManager::instance().get(textureKey.data());
+		region = TextureManager::instance().getRegion(textureKey);
 	}
 
-	return Sprite::makeStatic(*texture);
+	_textures.push_back(region.texture);
+	return Sprite::makeStatic(region);
 }
 
 
@@ -95,6 +110,13 @@ void Arrow::init(Scenario& scenario)
 	setSize(BoundsOffset);
 	
 	_texturesBase.init(*this);
+
+	// The arrow never moves once placed, so the base paints in scenario coordinates until a gear turns. //
+	_scenario->getStaticLayers().add("arrow.base", [this](sf::RenderTarget& canvas, sf::RenderStates rs) {
+		rs.transform *= getTransform();
+		_texturesBase.drawBase(canvas, rs);
+	});
+
 	_playerId = _scenario->getPlayerId();
 	_bgen = _scenario->getBubbleGenerator();
 //	_fireSound = TODO
@@ -110,6 +132,16 @@ void Arrow::init(Scenario& scenario)
 	_nextBubble = nullptr;
 }
 
+void Arrow::setAngle(float angle)
+{
+	if (angle == _angle)
+		return;
+
+	_texturesBase.turnGears(angle - _angle);
+	_angle = angle;
+	_scenario->invalidateStaticLayers();
+}
+
 void Arrow::fireBubble()
 {
 	if (!_lockFire)
@@ -127,6 +159,7 @@ void Arrow::makeNext()
 {
 	_currentBubble = _nextBubble;
 	_currentBubble->setPosition(getWidth() / 2.f, getHeight() / 2.f);
+	_currentBubble->resetInterpolation();
 	_nextBubble = _bgen->makeBubble(true);
 	_nextBubble->setPosition(
 		_texturesBase.getPosition().x + 128.f - Bubble::Diameter / 4.f,
@@ -145,5 +178,7 @@ void Arrow::swapBubble()
 		std::swap(_currentBubble, _nextBubble);
 		_currentBubble->setPosition(oldNextPos);
 		_nextBubble->setPosition(oldCurrentPos);
+		_currentBubble->resetInterpolation();
+		_nextBubble->resetInterpolation();
 	}
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "bubble_gen.h"
+#include "sprite_batch.h"
 
 
 class Scenario;
@@ -33,6 +34,9 @@ private:
 	Sprite _lever;
 	std::array<Sprite, 4> _gears;
 
+	// Sprites only keep raw texture references, these keep them resident under a texture budget. //
+	std::vector<std::shared_ptr<sf::Texture>> _textures;
+
 public:
 	ArrowTextures() = default;
 	ArrowTextures(const ArrowTextures&) = delete;
@@ -51,8 +55,11 @@ public:
 	void drawBase(sf::RenderTarget& canvas, sf::RenderStates rs);
 	void drawArrow(sf::RenderTarget& canvas, sf::RenderStates rs);
 
+	// Meshing gears turn the other way than their neighbours. //
+	void turnGears(float degrees);
+
 private:
-	static Sprite loadSprite(std::string_view textureKey, std::string_view textureFilename);
+	Sprite loadSprite(std::string_view textureKey, std::string_view textureFilename);
 
 	inline float pbx(float point) const { return (getWidth() * point) / _base.getWidth(); }
 	inline float pby(float point) const { return (getHeight() * point) / _base.getHeight(); }
@@ -93,6 +100,7 @@ private:
 private:
 	Reference<Scenario> _scenario;
 	ArrowTextures _texturesBase;
+	SpriteBatch _batch;
 	PlayerId _playerId = PlayerId::Single;
 	std::shared_ptr<BubbleGenerator> _bgen;
 //	std::shared_ptr<sf::Sound> _fireSound; TODO
@@ -140,11 +148,18 @@ public:
 
 	void fireBubble();
 
+	constexpr float getAngle() const { return _angle; }
+
+	// Every change turns the gears, which repaints the scenario static layers. //
+	void setAngle(float angle);
+
 public:
 	inline void render(sf::RenderTarget& canvas, sf::RenderStates rs) override
 	{
 		rs.transform *= getTransform();
-		_texturesBase.drawBase(canvas, rs);
+
+		// The base is painted into the scenario static layers. //
+		SpriteBatch::Scope batch(_batch, canvas);
 		_texturesBase.drawArrow(canvas, rs);
 	}
 
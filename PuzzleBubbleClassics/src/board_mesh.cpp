@@ -0,0 +1,191 @@
+#include "board_mesh.h"
+
+#include "bubble.h"
+#include "utils/profiler.h"
+
+
+void BubbleBoardMesh::reserveRow(RowIndex row)
+{
+	const std::size_t slots = slotIndex(row + 1, 0);
+	if (slots <= _slots.size())
+		return;
+
+	_slots.resize(slots);
+	_vertices.resize(slots * VerticesPerSlot);
+	_resized = true;
+}
+
+void BubbleBoardMesh::writeSlot(std::size_t slot, bool texCoordsOnly)
+{
+	sf::Vertex* vertices = _vertices.data() + slot * VerticesPerSlot;
+	const Slot& entry = _slots[slot];
+
+	// Empty cells stay in the buffer as degenerate triangles. //
+	if (entry.bubble == nullptr)
+	{
+		std::fill_n(vertices, VerticesPerSlot, sf::Vertex());
+		markDirty(slot);
+		return;
+	}
+
+	sf::Vertex quad[4];
+	entry.bubble->getSprite().getQuad(quad, entry.bubble->getTransform());
+
+	// Strip order 0-1-2-3 becomes triangles 0-1-2 and 2-1-3, as in SpriteBatch. //
+	const sf::Vertex ordered[VerticesPerSlot] = { quad[0], quad[1], quad[2], quad[2], quad[1], quad[3] };
+	if (texCoordsOnly)
+	{
+		bool changed = false;
+		for (std::size_t i = 0; i < VerticesPerSlot; ++i)
+		{
+			changed = changed || vertices[i].texCoords != ordered[i].texCoords;
+			vertices[i].texCoords = ordered[i].texCoords;
+		}
+		if (!changed)
+			return;
+	}
+	else std::copy_n(ordered, VerticesPerSlot, vertices);
+
+	markDirty(slot);
+}
+
+void BubbleBoardMesh::setCell(RowIndex row, ColumnIndex column, const Bubble* bubble)
+{
+	if (column >= RowStride)
+		return;
+
+	reserveRow(row);
+	const std::size_t index = slotIndex(row, column);
+	Slot& slot = _slots[index];
+
+	if (slot.animated)
+		std::erase(_animated, index);
+
+	slot.bubble = bubble;
+	slot.texture = nullptr;
+	slot.animated = false;
+	if (bubble != nullptr && bubble->getSprite().isValid() && bubble->getSprite().hasTexture())
+	{
+		slot.texture = std::addressof(bubble->getSprite().getTexture());
+		slot.animated = bubble->getSprite().getType() != SpriteType::Static;
+		if (slot.animated)
+			_animated.push_back(index);
+	}
+	else slot.bubble = nullptr;
+
+	writeSlot(index, false);
+	_stats.patchedCells++;
+}
+
+void BubbleBoardMesh::clearRow(RowIndex row)
+{
+	if (slotIndex(row, 0) >= _slots.size())
+		return;
+
+	for (ColumnIndex column = 0; column < RowStride; ++column)
+		if (_slots[slotIndex(row, column)].bubble != nullptr)
+			clearCell(row, column);
+}
+
+void BubbleBoardMesh::translateRow(RowIndex row, const sf::Vector2f& delta)
+{
+	if (slotIndex(row, 0) >= _slots.size())
+		return;
+
+	for (ColumnIndex column = 0; column < RowStride; ++column)
+	{
+		const std::size_t index = slotIndex(row, column);
+		if (_slots[index].bubble == nullptr)
+			continue;
+
+		sf::Vertex* vertices = _vertices.data() + index * VerticesPerSlot;
+		for (std::size_t i = 0; i < VerticesPerSlot; ++i)
+			vertices[i].position += delta;
+		markDirty(index);
+	}
+}
+
+void BubbleBoardMesh::clear()
+{
+	_slots.clear();
+	_vertices.clear();
+	_animated.clear();
+	_dirtyBegin = _dirtyEnd = 0;
+	_resized = true;
+}
+
+void BubbleBoardMesh::refreshAnimated()
+{
+	for (std::size_t index : _animated)
+		writeSlot(index, true);
+}
+
+void BubbleBoardMesh::upload()
+{
+	if (!sf::VertexBuffer::isAvailable())
+	{
+		_dirtyBegin = _dirtyEnd = 0;
+		_resized = false;
+		return;
+	}
+
+	if (_resized)
+	{
+		if (_vertices.empty() || !_buffer.create(_vertices.size()) || !_buffer.update(_vertices.data()))
+			_buffer.create(0);
+		_stats.uploadedVertices += _vertices.size();
+		_stats.uploads++;
+	}
+	else if (_dirtyBegin != _dirtyEnd)
+	{
+		_buffer.update(_vertices.data() + _dirtyBegin, _dirtyEnd - _dirtyBegin, unsigned(_dirtyBegin));
+		_stats.uploadedVertices += _dirtyEnd - _dirtyBegin;
+		_stats.uploads++;
+	}
+
+	_dirtyBegin = _dirtyEnd = 0;
+	_resized = false;
+}
+
+void BubbleBoardMesh::render(sf::RenderTarget& canvas, sf::RenderStates rs)
+{
+	if (_slots.empty())
+		return;
+
+	PROFILE_ZONE("BubbleBoardMesh::render");
+	refreshAnimated();
+	upload();
+
+	const bool buffered = _buffer.getVertexCount() == _vertices.size();
+	const auto drawRun = [this, &canvas, &rs, buffered](std::size_t first, std::size_t last, const sf::Texture* texture) {
+		if (texture == nullptr)
+			return;
+
+		rs.texture = texture;
+		const std::size_t offset = first * VerticesPerSlot;
+		const std::size_t count = (last - first) * VerticesPerSlot;
+		if (buffered)
+			canvas.draw(_buffer, offset, count, rs);
+		else
+			canvas.draw(_vertices.data() + offset, count, sf::Triangles, rs);
+		_stats.drawCalls++;
+	};
+
+	// Runs of slots sharing a texture; empty slots join any run. //
+	std::size_t first = 0;
+	const sf::Texture* texture = nullptr;
+	for (std::size_t i = 0; i < _slots.size(); ++i)
+	{
+		const sf::Texture* slotTexture = _slots[i].texture;
+		if (slotTexture == nullptr || slotTexture == texture)
+			continue;
+
+		if (texture != nullptr)
+		{
+			drawRun(first, i, texture);
+			first = i;
+		}
+		texture = slotTexture;
+	}
+	drawRun(first, _slots.size(), texture);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "level.h"
+
+#include "utils/reference.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <vector>
+
+
+class Bubble;
+
+
+struct BubbleBoardMeshStats
+{
+	Uint64 patchedCells = 0;
+	Uint64 uploads = 0;
+	Uint64 uploadedVertices = 0;
+	Uint64 drawCalls = 0;
+};
+
+
+/*
+	Retained quads of the bubbles resting on a board, one slot of two triangles per cell. Slots are
+	patched when a cell changes and translated when its row descends; animated sprites only refresh
+	their texture coordinates. Only the dirty range is uploaded to the vertex buffer, and the board is
+	drawn with one call per run of slots sharing a texture, a single one when the bubbles share an atlas page.
+*/
+class BubbleBoardMesh
+{
+public:
+	static constexpr std::size_t VerticesPerSlot = 6;
+
+private:
+	static constexpr ColumnCount RowStride = utils::level::MaxColumnCount;
+
+	struct Slot
+	{
+		ConstReference<Bubble> bubble = nullptr;
+		const sf::Texture* texture = nullptr;
+		bool animated = false;
+	};
+
+private:
+	std::vector<Slot> _slots;
+	std::vector<sf::Vertex> _vertices;
+	std::vector<std::size_t> _animated;
+	sf::VertexBuffer _buffer = sf::VertexBuffer(sf::Triangles, sf::VertexBuffer::Dynamic);
+	std::size_t _dirtyBegin = 0;
+	std::size_t _dirtyEnd = 0;
+	bool _resized = false;
+	BubbleBoardMeshStats _stats;
+
+public:
+	BubbleBoardMesh() = default;
+	BubbleBoardMesh(const BubbleBoardMesh&) = delete;
+	BubbleBoardMesh(BubbleBoardMesh&&) noexcept = default;
+	~BubbleBoardMesh() = default;
+
+	BubbleBoardMesh& operator= (const BubbleBoardMesh&) = delete;
+	BubbleBoardMesh& operator= (BubbleBoardMesh&&) noexcept = default;
+
+public:
+	// Bubble positions are in board space. A null bubble empties the cell. //
+	void setCell(RowIndex row, ColumnIndex column, const Bubble* bubble);
+	inline void clearCell(RowIndex row, ColumnIndex column) { setCell(row, column, nullptr); }
+
+	void clearRow(RowIndex row);
+	void translateRow(RowIndex row, const sf::Vector2f& delta);
+
+	void clear();
+
+	void render(sf::RenderTarget& canvas, sf::RenderStates rs);
+
+public:
+	constexpr const BubbleBoardMeshStats& getStats() const { return _stats; }
+
+private:
+	static constexpr std::size_t slotIndex(RowIndex row, ColumnIndex column) { return std::size_t(row) * RowStride + column; }
+
+	inline void markDirty(std::size_t slot)
+	{
+		const std::size_t first = slot * VerticesPerSlot;
+		if (_dirtyBegin == _dirtyEnd)
+			_dirtyBegin = first, _dirtyEnd = first + VerticesPerSlot;
+		else
+			_dirtyBegin = std::min(_dirtyBegin, first), _dirtyEnd = std::max(_dirtyEnd, first + VerticesPerSlot);
+	}
+
+	void reserveRow(RowIndex row);
+	void writeSlot(std::size_t slot, bool texCoordsOnly);
+	void refreshAnimated();
+	void upload();
+};
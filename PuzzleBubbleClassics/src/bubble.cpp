@@ -1,6 +1,7 @@
 #include "bubble.h"
 
 #include "data.h"
+#include "utils/profiler.h"
 
 
 EdgeBounce BouncingBounds::check()
@@ -13,6 +14,7 @@ BubbleModelManager BubbleModelManager::Instance;
 
 std::shared_ptr<BubbleModel> BubbleModelManager::load(const std::string_view name)
 {
+	PROFILE_ZONE("BubbleModelManager::load");
 	std::optional<Path> path = DataPool::instance().findFilePath(ResourceDirectoryType::Bubbles, name);
 	if (!path.has_value())
 		return nullptr;
@@ -58,7 +60,7 @@ std::shared_ptr<Bubble> Bubble::make(const std::shared_ptr<BubbleModel>& model,
 
 std::shared_ptr<Bubble> Bubble::make(std::string_view model, BubbleColor color, bool editorMode)
 {
-	return make(BubbleModelManager::instance().get(model.data()), color, editorMode); 
+	return make(BubbleModelManager::instance().get(model), color, editorMode); 
 }
 
 
@@ -30,6 +30,8 @@ std::shared_ptr<Bubble> BubbleBoardRow::setBubble(ColumnIndex column, const std:
 		_bubbleCount++;
 	}
 	_cells[column].setBubble(bubble);
+	if (_owner != nullptr)
+		_owner->getMesh().setCell(_row, column, bubble.get());
 	return old;
 }
 
@@ -47,6 +49,8 @@ std::shared_ptr<Bubble> BubbleBoardRow::removeBubble(ColumnIndex column)
 		auto bubble = cell.getBubble();
 		cell.clear();
 		_bubbleCount--;
+		if (_owner != nullptr)
+			_owner->getMesh().clearCell(_row, column);
 		return bubble;
 	}
 	return nullptr;
@@ -58,6 +62,9 @@ std::size_t BubbleBoardRow::clear()
 	for (Cell& cell : _cells)
 		if (cell.clear())
 			count++;
+
+	if (_owner != nullptr)
+		_owner->getMesh().clearRow(_row);
 	return count;
 }
 
@@ -66,6 +73,9 @@ void BubbleBoardRow::descend()
 	for (const Cell& cell : _cells)
 		if (!cell.isEmpty())
 			cell->translate(0, float(Bubble::HitboxHeight));
+
+	if (_owner != nullptr)
+		_owner->getMesh().translateRow(_row, { 0, float(Bubble::HitboxHeight) });
 }
 
 bool BubbleBoardRow::hasInvalidBottomBubble() const
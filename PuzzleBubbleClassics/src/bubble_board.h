@@ -2,6 +2,7 @@
 
 #include "level.h"
 #include "bubble_gen.h"
+#include "board_mesh.h"
 
 #include <queue>
 
@@ -433,5 +434,13 @@ private:
 
 class BubbleBoard
 {
+private:
+	// Resting bubbles, kept in sync by the rows. //
+	BubbleBoardMesh _mesh;
+
+public:
+	constexpr BubbleBoardMesh& getMesh() { return _mesh; }
+	constexpr const BubbleBoardMesh& getMesh() const { return _mesh; }
 
+	inline void renderRestingBubbles(sf::RenderTarget& canvas, sf::RenderStates rs) { _mesh.render(canvas, rs); }
 };
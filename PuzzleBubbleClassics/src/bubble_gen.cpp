@@ -4,6 +4,7 @@
 void RandomBubbleModelSelector::build(const RandomBubbleModelSelectorScores& scores)
 {
 	_models = scores._models;
+	_recompute = true;
 	computeScore();
 }
 
@@ -14,12 +15,21 @@ std::shared_ptr<BubbleModel> RandomBubbleModelSelector::select(RNG& rand) const
 
 	computeScore();
 
+	BubbleModelManager& manager = BubbleModelManager::instance();
 	Int64 value = Int64(rand(0, RNG::ResultType(_score)));
-	for (const auto& model : _models)
+	for (auto& model : _resolved)
 	{
-		value -= model.second;
+		value -= model.score;
 		if (value < 0)
-			return BubbleModelManager::instance().get(model.first);
+		{
+			auto ptr = manager.get(model.handle);
+			if (ptr == nullptr)
+			{
+				model.handle = manager.resolve(model.name);
+				ptr = manager.get(model.handle);
+			}
+			return ptr;
+		}
 	}
 
 	return BubbleModelManager::instance().getDefaultModel();
@@ -41,8 +51,12 @@ void RandomBubbleModelSelector::computeScore() const
 	if (_recompute)
 	{
 		RNG::ResultType score = 0;
+		_resolved.clear();
 		for (const auto& model : _models)
+		{
 			score += model.second;
+			_resolved.push_back({ model.first, BubbleModelManager::instance().resolve(model.first), model.second });
+		}
 
 		_score = score;
 		_recompute = false;
@@ -17,8 +17,17 @@ public:
 	static constexpr ScoreType MinScore = utils::level::RandomBubbleModelSelectorMinScore;
 	static constexpr ScoreType MaxScore = utils::level::RandomBubbleModelSelectorMaxScore;
 
+private:
+	struct ResolvedModel
+	{
+		std::string name;
+		BubbleModelManager::Handle handle;
+		ScoreType score;
+	};
+
 private:
 	std::unordered_map<std::string, ScoreType> _models;
+	mutable std::vector<ResolvedModel> _resolved;
 	mutable RNG::ResultType _score = 0;
 	mutable bool _recompute = true;
 
@@ -79,6 +88,9 @@ public:
 	constexpr void setRand(const RNG& rand) { _rand = rand; }
 	constexpr void setRand(RNG&& rand) { _rand = std::move(rand); }
 
+	constexpr RNG& getRand() { return _rand; }
+	constexpr const RNG& getRand() const { return _rand; }
+
 	inline void setAvailableColors(AvailableColorsTable availableColors)
 	{
 		_availableColors = availableColors;
@@ -134,6 +146,12 @@ public:
 	constexpr RandomBubbleModelSelector& getBoardModelSelector() { return _boardModels; }
 	constexpr const RandomBubbleModelSelector& getBoardModelSelector() const { return _boardModels; }
 
+	constexpr RNG& getRand(bool toArrow) { return rand(toArrow); }
+	constexpr const RNG& getRand(bool toArrow) const { return toArrow ? _arrowRand : _boardRand; }
+
+	constexpr BubbleColorRandomizer& getColorRandomizer() { return _colors; }
+	constexpr const BubbleColorRandomizer& getColorRandomizer() const { return _colors; }
+
 	inline std::shared_ptr<Bubble> makeBubble(const std::shared_ptr<BubbleModel>& model, bool toArrow)
 	{
 		return Bubble::make(model, selectColor(toArrow), false);
@@ -2,6 +2,9 @@
 
 #include "font.h"
 
+#include <algorithm>
+#include <cctype>
+
 
 void ResourcePackage::forEachValidDirectory(const std::function<void(Reference<resources::Directory>, ResourceDirectoryType)>& action)
 {
@@ -10,6 +13,14 @@ void ResourcePackage::forEachValidDirectory(const std::function<void(Reference<r
 			action(_dirs[int(type)].get(), type);
 }
 
+void ResourcePackage::forEachArchiveEntry(ResourceDirectoryType type, const std::function<void(const resources::ArchiveEntry&, std::string_view)>& action) const
+{
+	if (!hasArchiveDirectory(type))
+		return;
+
+	_archive->forEachEntry(_archiveDirs[std::size_t(type)].value(), action);
+}
+
 
 
 static constexpr std::string_view resourceDirectoryName(ResourceDirectoryType type)
@@ -21,39 +32,64 @@ static constexpr std::string_view resourceDirectoryName(ResourceDirectoryType ty
 		case Textures: return "textures";
 		case Fonts: return "fonts";
 		case Audio: return "audio";
+		case Particles: return "particles";
 		default: return "invalid-resource-directory";
 	}
 }
 
 
-bool ResourcePackage::load()
+static void forEachConfiguredDirectory(const JsonValue& config, std::string_view field, const std::function<void(ResourceDirectoryType, const std::string&)>& action)
 {
-	const JsonValue config = loadConfigFile();
+	if (!config.contains(field))
+		return;
 
-	if (config.contains(DirectoriesConfigField))
+	const JsonValue& directories = config.at(field);
+	if (!directories.is_object())
+		return;
+
+	for (ResourceDirectoryType type = ResourceDirectoryType::First; type < ResourceDirectoryType::Count; type = ResourceDirectoryType(int(type) + 1))
 	{
-		const JsonValue& directories = config.at(DirectoriesConfigField);
-		if (directories.is_object())
+		const std::string_view name = resourceDirectoryName(type);
+		if (directories.contains(name))
 		{
-			for (ResourceDirectoryType type = ResourceDirectoryType::First; type < ResourceDirectoryType::Count; type = ResourceDirectoryType(int(type) + 1))
-			{
-				const std::string_view name = resourceDirectoryName(type);
-				if (directories.contains(name))
-				{
-					const JsonValue& jDirName = directories.at(name);
-					if (jDirName.is_string())
-					{
-						const std::string& dirName = jDirName.get_ref<const std::string&>();
-						const Path dirPath = utils::path::normalize(_root.resolve(dirName));
-						if (utils::path::isDirectory(dirPath))
-						{
-							_dirs[std::size_t(type)].reset(new resources::Directory(dirPath));
-						}
-					}
-				}
-			}
+			const JsonValue& jDirName = directories.at(name);
+			if (jDirName.is_string())
+				action(type, jDirName.get_ref<const std::string&>());
 		}
 	}
+}
+
+bool ResourcePackage::load()
+{
+	const JsonValue config = loadConfigFile();
+
+	forEachConfiguredDirectory(config, DirectoriesConfigField, [this](ResourceDirectoryType type, const std::string& dirName) {
+		const Path dirPath = utils::path::normalize(_root.resolve(dirName));
+		if (utils::path::isDirectory(dirPath))
+		{
+			_dirs[std::size_t(type)].reset(new resources::Directory(dirPath));
+		}
+	});
+
+	return true;
+}
+
+bool ResourcePackage::loadArchive()
+{
+	JsonValue config = _archive->readJson(PackageConfigFileName);
+	if (!config.is_object())
+		config = JsonObject();
+
+	forEachConfiguredDirectory(config, DirectoriesConfigField, [this](ResourceDirectoryType type, const std::string& dirName) {
+		// Lua modules resolve their imports on the file system, so bubble scripts must stay loose. //
+		if (type == ResourceDirectoryType::Bubbles)
+		{
+			logger::warn("Package '{}': Bubble models are not supported inside archives.", _archive->path().string());
+			return;
+		}
+
+		_archiveDirs[std::size_t(type)] = Path(dirName).lexically_normal().generic_string();
+	});
 
 	return true;
 }
@@ -83,6 +119,17 @@ JsonValue ResourcePackage::loadConfigFile()
 DataPool DataPool::Instance;
 
 bool DataPool::load()
+{
+	if (!mount())
+		return false;
+
+	buildIndex();
+	loadPackagesData();
+
+	return true;
+}
+
+bool DataPool::mount()
 {
 	_packages.clear();
 
@@ -97,6 +144,31 @@ bool DataPool::load()
 	return true;
 }
 
+void DataPool::loadPackagesData()
+{
+	for (const auto& package : _packages)
+		loadPackageData(package.get());
+}
+
+void DataPool::rescan()
+{
+	buildIndex();
+}
+
+bool DataPool::rescanIfModified()
+{
+	for (const auto& [dir, timestamp] : _indexedDirectories)
+	{
+		std::error_code ec;
+		if (std::filesystem::last_write_time(dir, ec) != timestamp || ec)
+		{
+			buildIndex();
+			return true;
+		}
+	}
+	return false;
+}
+
 bool DataPool::loadDefaultPackage()
 {
 	std::unique_ptr<ResourcePackage> package = std::unique_ptr<ResourcePackage>(new ResourcePackage(resources::data.path()));
@@ -105,9 +177,8 @@ bool DataPool::loadDefaultPackage()
 		logger::error("Default Package: Error during loading resources.");
 		return false;
 	}
-	Reference<ResourcePackage> ref = package.get();
 	_packages.push_back(std::move(package));
-	return loadPackageData(ref);
+	return true;
 }
 
 bool DataPool::loadPackages()
@@ -119,6 +190,11 @@ bool DataPool::loadPackages()
 			if (!loadPackage(elemPath))
 				result = false;
 		}
+		else if (utils::path::isFile(elemPath) && utils::path::hasExtension(elemPath, resources::Archive::Extension))
+		{
+			if (!loadArchivePackage(elemPath))
+				result = false;
+		}
 	});
 	return result;
 }
@@ -131,15 +207,49 @@ bool DataPool::loadPackage(const Path& path)
 		logger::error("Package '{}': Error during loading resources.", path.string());
 		return false;
 	}
-	Reference<ResourcePackage> ref = package.get();
 	_packages.push_back(std::move(package));
-	return loadPackageData(ref);
+	return true;
+}
+
+bool DataPool::loadArchivePackage(const Path& path)
+{
+	// Mappings are kept for the whole pool lifetime: fonts keep reading from them after loading. //
+	const Path key = utils::path::absolute(path);
+	std::shared_ptr<resources::Archive>& archive = _archives[key];
+	if (archive == nullptr)
+	{
+		archive = std::make_shared<resources::Archive>();
+		if (!archive->open(key))
+		{
+			_archives.erase(key);
+			logger::error("Package '{}': Cannot open archive.", path.string());
+			return false;
+		}
+	}
+
+	std::unique_ptr<ResourcePackage> package = std::unique_ptr<ResourcePackage>(new ResourcePackage(archive));
+	if (!package->loadArchive())
+	{
+		logger::error("Package '{}': Error during loading resources.", path.string());
+		return false;
+	}
+	_packages.push_back(std::move(package));
+	return true;
 }
 
 bool DataPool::loadPackageData(Reference<ResourcePackage> package)
 {
 	if (package->hasDirectory(ResourceDirectoryType::Fonts))
-		FontManager::instance().loadAllFromDirectory(package->getDirectory(ResourceDirectoryType::Fonts)->path());
+		FontManager::instance().loadAllFromDirectoryAsync(package->getDirectory(ResourceDirectoryType::Fonts)->path());
+
+	if (package->hasArchiveDirectory(ResourceDirectoryType::Fonts))
+	{
+		const resources::Archive& archive = *package->getArchive();
+		package->forEachArchiveEntry(ResourceDirectoryType::Fonts, [&archive](const resources::ArchiveEntry& entry, std::string_view) {
+			if (utils::path::hasExtension(Path(entry.path), ".ttf"))
+				FontManager::instance().loadAsync(ResourceLocation(archive, entry));
+		});
+	}
 
 	return true;
 }
@@ -158,16 +268,106 @@ void DataPool::buildPaths()
 	}
 }
 
+static std::string indexKey(const Path& relative)
+{
+	// Keys are case insensitive, like the file system lookups they replace. //
+	std::string key = relative.lexically_normal().generic_string();
+	std::transform(key.begin(), key.end(), key.begin(), [](char c) { return char(std::tolower(static_cast<unsigned char>(c))); });
+	return key;
+}
 
-std::optional<Path> DataPool::findFilePath(ResourceDirectoryType type, std::string_view name, std::initializer_list<std::string_view> extensions)
+void DataPool::buildIndex()
 {
-	for (const auto& dir : _paths[int(type)])
+	namespace fs = std::filesystem;
+
+	_indexedDirectories.clear();
+	for (auto& index : _index)
+		index.clear();
+
+	// Packages are walked from the highest priority down, so the first inserted path of each key wins. //
+	std::size_t priority = 0;
+	const auto end = _packages.crend();
+	for (auto it = _packages.crbegin(); it != end; it++, priority++)
 	{
-		auto filePath = utils::path::findFirstValidPath(dir->path(), name, extensions);
-		if (filePath.has_value())
-			return filePath;
+		const ResourcePackage& package = **it;
+		for (ResourceDirectoryType type = ResourceDirectoryType::First; type < ResourceDirectoryType::Count; type = ResourceDirectoryType(int(type) + 1))
+		{
+			FileIndex& index = _index[int(type)];
+
+			if (package.isArchive())
+			{
+				const resources::Archive& archive = *package.getArchive();
+				package.forEachArchiveEntry(type, [&index, &archive, priority](const resources::ArchiveEntry& entry, std::string_view relative) {
+					index.try_emplace(indexKey(Path(relative)), IndexEntry{ priority, ResourceLocation(archive, entry) });
+				});
+				continue;
+			}
+
+			const Reference<resources::Directory> dir = package.getDirectory(type);
+			if (dir == nullptr)
+				continue;
+
+			const Path& root = dir->path();
+			std::error_code ec;
+			if (!fs::is_directory(root, ec))
+				continue;
+
+			_indexedDirectories.push_back({ root, fs::last_write_time(root, ec) });
+			for (auto dirIt = fs::recursive_directory_iterator(root, ec); !ec && dirIt != fs::recursive_directory_iterator(); dirIt.increment(ec))
+			{
+				if (dirIt->is_directory(ec))
+					_indexedDirectories.push_back({ dirIt->path(), fs::last_write_time(dirIt->path(), ec) });
+				else if (dirIt->is_regular_file(ec))
+					index.try_emplace(indexKey(dirIt->path().lexically_relative(root)), IndexEntry{ priority, ResourceLocation(utils::path::absolute(dirIt->path())) });
+			}
+		}
+	}
+}
+
+std::optional<ResourceLocation> DataPool::findFile(ResourceDirectoryType type, std::string_view name, std::initializer_list<std::string_view> extensions)
+{
+	if (name.empty())
+		return {};
+
+	// Mirrors utils::path::findFirstValidPath over every package directory: the highest priority directory
+	// holding any candidate wins, and within it candidates are tried from the deepest path upwards. //
+	const FileIndex& index = _index[int(type)];
+	const IndexEntry* best = nullptr;
+	const auto probe = [&index, &best](const Path& candidate) {
+		auto it = index.find(indexKey(candidate));
+		if (it != index.end() && (best == nullptr || it->second.priority < best->priority))
+			best = std::addressof(it->second);
+	};
+
+	const Path relative = Path(name);
+	const Path filename = relative.filename();
+	Path parent = relative.parent_path();
+	while (true)
+	{
+		Path candidate = parent / filename;
+		if (extensions.size() > 0)
+		{
+			for (const auto& extension : extensions)
+				probe(candidate.replace_extension(extension));
+		}
+		else probe(candidate);
+
+		if (parent.empty())
+			break;
+		parent = parent.parent_path();
 	}
-	return {};
+
+	if (best == nullptr)
+		return {};
+	return best->location;
+}
+
+std::optional<Path> DataPool::findFilePath(ResourceDirectoryType type, std::string_view name, std::initializer_list<std::string_view> extensions)
+{
+	auto location = findFile(type, name, extensions);
+	if (!location.has_value())
+		return {};
+	return location->path();
 }
 
 void DataPool::forEachDirectory(ResourceDirectoryType type, const std::function<void(Reference<resources::Directory>)>& action)
@@ -176,6 +376,12 @@ void DataPool::forEachDirectory(ResourceDirectoryType type, const std::function<
 		action(dir);
 }
 
+void DataPool::forEachIndexedFile(ResourceDirectoryType type, const std::function<void(const ResourceLocation&, std::size_t)>& action) const
+{
+	for (const auto& [key, entry] : _index[int(type)])
+		action(entry.location, entry.priority);
+}
+
 
 static void scanDirectoryPaths(const Path& dir, const std::function<void(const Path&)>& action, bool deep)
 {
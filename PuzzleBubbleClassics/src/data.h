@@ -5,9 +5,11 @@
 #include "utils/reference.h"
 
 #include "resources.h"
+#include "archive.h"
 
 #include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 
@@ -19,6 +21,7 @@ enum class ResourceDirectoryType
 	Textures,
 	Fonts,
 	Audio,
+	Particles,
 
 	Count,
 	Last = Count - 1
@@ -27,10 +30,59 @@ enum class ResourceDirectoryType
 
 class DataPool;
 
+class ResourceLocation
+{
+private:
+	Path _path;
+	Reference<const resources::Archive> _archive;
+	Reference<const resources::ArchiveEntry> _entry;
+
+public:
+	ResourceLocation() = default;
+	ResourceLocation(const ResourceLocation&) = default;
+	ResourceLocation(ResourceLocation&&) noexcept = default;
+	~ResourceLocation() = default;
+
+	ResourceLocation& operator= (const ResourceLocation&) = default;
+	ResourceLocation& operator= (ResourceLocation&&) noexcept = default;
+
+public:
+	inline ResourceLocation(const Path& path) : _path(path), _archive(), _entry() {}
+	inline ResourceLocation(const resources::Archive& archive, const resources::ArchiveEntry& entry) :
+		_path(archive.path() / entry.path),
+		_archive(std::addressof(archive)),
+		_entry(std::addressof(entry))
+	{}
+
+	// Archived files get a virtual path below the archive file. //
+	inline const Path& path() const { return _path; }
+
+	constexpr bool isArchived() const { return _archive != nullptr; }
+
+	inline std::size_t size() const
+	{
+		if (isArchived())
+			return std::size_t(_entry->size);
+
+		std::error_code ec;
+		const auto bytes = std::filesystem::file_size(_path, ec);
+		return ec ? 0 : std::size_t(bytes);
+	}
+
+	inline std::optional<std::span<const std::byte>> read() const
+	{
+		if (!isArchived())
+			return {};
+		return _archive->read(*_entry);
+	}
+};
+
+
 class ResourcePackage
 {
 public:
 	using DirectoriesArray = std::array<std::unique_ptr<resources::Directory>, std::size_t(ResourceDirectoryType::Count)>;
+	using ArchiveDirectoriesArray = std::array<std::optional<std::string>, std::size_t(ResourceDirectoryType::Count)>;
 
 	friend DataPool;
 
@@ -43,6 +95,9 @@ private:
 	resources::Directory _root;
 	DirectoriesArray _dirs;
 
+	std::shared_ptr<resources::Archive> _archive;
+	ArchiveDirectoriesArray _archiveDirs;
+
 public:
 	ResourcePackage() = delete;
 	ResourcePackage(const ResourcePackage&) = delete;
@@ -53,9 +108,11 @@ public:
 	ResourcePackage& operator= (ResourcePackage&&) noexcept = delete;
 
 private:
-	ResourcePackage(const Path& path) : _root(path), _dirs() {}
+	ResourcePackage(const Path& path) : _root(path), _dirs(), _archive(), _archiveDirs() {}
+	ResourcePackage(const std::shared_ptr<resources::Archive>& archive) : _root(archive->path()), _dirs(), _archive(archive), _archiveDirs() {}
 
 	bool load();
+	bool loadArchive();
 	bool loadDefault();
 	JsonValue loadConfigFile();
 
@@ -75,8 +132,18 @@ public:
 
 	constexpr Reference<resources::Directory> operator[] (ResourceDirectoryType type) { return getDirectory(type); }
 
+	inline bool isArchive() const { return _archive != nullptr; }
+	inline Reference<const resources::Archive> getArchive() const { return _archive.get(); }
+
+	inline bool hasArchiveDirectory(ResourceDirectoryType type) const
+	{
+		return type >= ResourceDirectoryType::First && type <= ResourceDirectoryType::Last && _archiveDirs[std::size_t(type)].has_value();
+	}
+
 public:
 	void forEachValidDirectory(const std::function<void(Reference<resources::Directory>, ResourceDirectoryType)>& action);
+
+	void forEachArchiveEntry(ResourceDirectoryType type, const std::function<void(const resources::ArchiveEntry&, std::string_view)>& action) const;
 };
 
 
@@ -86,12 +153,25 @@ class DataPool
 private:
 	using PathsArray = std::array<std::vector<Reference<resources::Directory>>, std::size_t(ResourceDirectoryType::Count)>;
 
+	struct IndexEntry
+	{
+		std::size_t priority;
+		ResourceLocation location;
+	};
+
+	using FileIndex = std::unordered_map<std::string, IndexEntry>;
+	using IndexArray = std::array<FileIndex, std::size_t(ResourceDirectoryType::Count)>;
+	using DirectoryTimestamps = std::vector<std::pair<Path, std::filesystem::file_time_type>>;
+
 private:
 	static DataPool Instance;
 
 private:
 	std::vector<std::unique_ptr<ResourcePackage>> _packages;
+	std::unordered_map<Path, std::shared_ptr<resources::Archive>> _archives;
 	PathsArray _paths;
+	IndexArray _index;
+	DirectoryTimestamps _indexedDirectories;
 
 public:
 	DataPool(const DataPool&) = delete;
@@ -107,23 +187,40 @@ private:
 public:
 	bool load();
 
+	// Startup steps of load(), so they can be scheduled separately. //
+	bool mount();
+	void loadPackagesData();
+
+	void rescan();
+	bool rescanIfModified();
+
+	std::optional<ResourceLocation> findFile(ResourceDirectoryType type, std::string_view name, std::initializer_list<std::string_view> extensions);
+
 	std::optional<Path> findFilePath(ResourceDirectoryType type, std::string_view name, std::initializer_list<std::string_view> extensions);
 
 	void forEachDirectory(ResourceDirectoryType type, const std::function<void(Reference<resources::Directory>)>& action);
 
 	void forEachDirectoryPath(ResourceDirectoryType type, const std::function<void(const Path&)>& action, bool deep = true);
 
+	// Every indexed file that wins its lookup, with the priority of its package (0 is the highest). //
+	void forEachIndexedFile(ResourceDirectoryType type, const std::function<void(const ResourceLocation&, std::size_t)>& action) const;
+
 public:
 	inline std::optional<Path> findFilePath(ResourceDirectoryType type, std::string_view name, std::string_view extension) { return findFilePath(type, name, { extension }); }
 	inline std::optional<Path> findFilePath(ResourceDirectoryType type, std::string_view name) { return findFilePath(type, name, {}); }
 
+	inline std::optional<ResourceLocation> findFile(ResourceDirectoryType type, std::string_view name, std::string_view extension) { return findFile(type, name, { extension }); }
+	inline std::optional<ResourceLocation> findFile(ResourceDirectoryType type, std::string_view name) { return findFile(type, name, {}); }
+
 private:
 	bool loadDefaultPackage();
 	bool loadPackages();
 	bool loadPackage(const Path& path);
+	bool loadArchivePackage(const Path& path);
 	bool loadPackageData(Reference<ResourcePackage> package);
 
 	void buildPaths();
+	void buildIndex();
 
 public:
 	static constexpr DataPool& instance() { return Instance; }
@@ -2,13 +2,26 @@
 
 #include "utils/logger.h"
 #include "utils/path.h"
+#include "utils/profiler.h"
 
 
 FontManager FontManager::Instance;
 
-FontManager::Pointer FontManager::load(const Path& path)
+static bool loadFont(sf::Font& font, const ResourceLocation& location)
 {
-	std::string id = path.filename().replace_extension().string();
+	// sf::Font streams glyphs from the given memory, archived fonts point straight into the mapping. //
+	if (location.isArchived())
+	{
+		const auto data = location.read();
+		return data.has_value() && font.loadFromMemory(data->data(), data->size());
+	}
+	return font.loadFromFile(location.path().string());
+}
+
+FontManager::Pointer FontManager::load(const ResourceLocation& location)
+{
+	PROFILE_ZONE("FontManager::load");
+	std::string id = utils::path::getFileName(location.path(), false);
 	if (contains(id))
 		destroy(id);
 
@@ -16,16 +29,35 @@ FontManager::Pointer FontManager::load(const Path& path)
 	if (ptr == nullptr)
 		return nullptr;
 
-	if (!ptr->loadFromFile(path.string()))
+	if (!loadFont(*ptr, location))
 	{
-		logger::error("Font: Cannot open font file '{}'.", path.string());
+		logger::error("Font: Cannot open font file '{}'.", location.path().string());
 		destroy(id);
 		return nullptr;
 	}
 
+	_sources.insert_or_assign(id, location);
+	remeasure(id);
 	return ptr;
 }
 
+std::size_t FontManager::measure(const std::string& id, const sf::Font& font) const
+{
+	// Glyph pages are created lazily, the face data is the part that is known up front. //
+	auto it = _sources.find(id);
+	return it == _sources.end() ? 0 : it->second.size();
+}
+
+FontManager::Pointer FontManager::reload(const std::string& id)
+{
+	auto it = _sources.find(id);
+	if (it == _sources.end())
+		return nullptr;
+
+	const ResourceLocation location = it->second;
+	return load(location);
+}
+
 bool FontManager::loadAllFromDirectory(const Path& path)
 {
 	if (!utils::path::isDirectory(path))
@@ -40,3 +72,37 @@ bool FontManager::loadAllFromDirectory(const Path& path)
 
 	return true;
 }
+
+LoadHandle<sf::Font> FontManager::loadAsync(const ResourceLocation& location)
+{
+	return ResourceLoader::instance().submit<sf::Font, Pointer>(
+		[location]() -> std::optional<Pointer> {
+			auto font = std::make_shared<sf::Font>();
+			if (!loadFont(*font, location))
+			{
+				logger::error("Font: Cannot open font file '{}'.", location.path().string());
+				return {};
+			}
+			return font;
+		},
+		[this, location, id = utils::path::getFileName(location.path(), false)](Pointer& font) {
+			_sources.insert_or_assign(id, location);
+			return insert(id, font);
+		}
+	);
+}
+
+bool FontManager::loadAllFromDirectoryAsync(const Path& path)
+{
+	if (!utils::path::isDirectory(path))
+	{
+		logger::error("Font Directory load: Expected valid directory, but found '{}'.", path.string());
+		return false;
+	}
+
+	utils::path::scanDirectoryFiles(path, ".ttf", [this](const Path& filePath) {
+		loadAsync(ResourceLocation(filePath));
+	});
+
+	return true;
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "resource_loader.h"
+#include "data.h"
+
 #include "utils/manager.h"
 #include "utils/path.h"
 
@@ -11,14 +14,24 @@ class FontManager : public Manager<sf::Font>
 private:
 	static FontManager Instance;
 
+private:
+	std::unordered_map<std::string, ResourceLocation> _sources;
+
 public:
-	Pointer load(const Path& path);
+	Pointer load(const ResourceLocation& location);
 
 	bool loadAllFromDirectory(const Path& path);
 
+	LoadHandle<sf::Font> loadAsync(const ResourceLocation& location);
+
+	bool loadAllFromDirectoryAsync(const Path& path);
+
 private:
 	inline FontManager() : Manager(nullptr) {}
 
+	std::size_t measure(const std::string& id, const sf::Font& font) const override;
+	Pointer reload(const std::string& id) override;
+
 public:
 	static constexpr FontManager& instance() { return Instance; }
 };
@@ -0,0 +1,102 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+
+void FramePacer::setRate(unsigned int framesPerSecond)
+{
+	_period = framesPerSecond > 0 ? sf::microseconds(1000000 / framesPerSecond) : sf::Time::Zero;
+	reset();
+}
+
+void FramePacer::reset()
+{
+	_next = _clock.getElapsedTime() + _period;
+}
+
+void FramePacer::waitFrame()
+{
+	if (!isPaced())
+		return;
+
+	waitUntil(_next);
+
+	const sf::Time now = _clock.getElapsedTime();
+	record(now - _next);
+
+	_next += _period;
+	if (now >= _next)
+		_next = now + _period;
+}
+
+void FramePacer::waitFor(sf::Time time)
+{
+	if (time > sf::Time::Zero)
+		waitUntil(_clock.getElapsedTime() + time);
+}
+
+FramePacingStats FramePacer::getStats() const
+{
+	FramePacingStats stats;
+	stats.frames = _frames;
+	stats.lateFrames = _lateFrames;
+	stats.meanOvershoot = _frames > 0 ? _totalOvershoot / static_cast<sf::Int64>(_frames) : sf::Time::Zero;
+	stats.maxOvershoot = _maxOvershoot;
+	stats.spinMargin = _spinMargin;
+	return stats;
+}
+
+void FramePacer::resetStats()
+{
+	_frames = 0;
+	_lateFrames = 0;
+	_totalOvershoot = sf::Time::Zero;
+	_maxOvershoot = sf::Time::Zero;
+}
+
+void FramePacer::waitUntil(sf::Time deadline)
+{
+	const sf::Time sleepTime = deadline - _clock.getElapsedTime() - _spinMargin;
+	if (sleepTime > sf::Time::Zero)
+	{
+		const sf::Time start = _clock.getElapsedTime();
+		sf::sleep(sleepTime);
+		const sf::Time error = _clock.getElapsedTime() - start - sleepTime;
+
+		if (error > _spinMargin)
+			_spinMargin = error;
+		else
+			_spinMargin -= (_spinMargin - error) / static_cast<sf::Int64>(16);
+		_spinMargin = std::clamp(_spinMargin, MinSpinMargin, MaxSpinMargin);
+	}
+
+	while (_clock.getElapsedTime() < deadline)
+		std::this_thread::yield();
+}
+
+void FramePacer::record(sf::Time overshoot)
+{
+	_frames++;
+	_totalOvershoot += overshoot;
+	_maxOvershoot = std::max(_maxOvershoot, overshoot);
+	if (overshoot > LateThreshold)
+		_lateFrames++;
+}
+
+unsigned int FramePacer::getDisplayRate()
+{
+#ifdef _WIN32
+	DEVMODEW mode = {};
+	mode.dmSize = sizeof(mode);
+	if (EnumDisplaySettingsW(nullptr, ENUM_CURRENT_SETTINGS, &mode) && mode.dmDisplayFrequency > 1)
+		return static_cast<unsigned int>(mode.dmDisplayFrequency);
+#endif
+	return DefaultDisplayRate;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "utils/rawtypes.h"
+
+#include <SFML/System.hpp>
+
+
+struct FramePacingStats
+{
+	Uint64 frames = 0;
+	Uint64 lateFrames = 0;
+	sf::Time meanOvershoot;
+	sf::Time maxOvershoot;
+	sf::Time spinMargin;
+};
+
+
+/*
+	Sleeps until a deadline with the OS timer and spins only for the calibrated tail where the
+	timer is not precise enough. The tail grows at once when a sleep oversleeps and shrinks slowly.
+*/
+class FramePacer
+{
+public:
+	static constexpr unsigned int DefaultDisplayRate = 60;
+
+	// Frames that miss their deadline by more than this are counted as late. //
+	static inline const sf::Time LateThreshold = sf::microseconds(500);
+
+	static inline const sf::Time MinSpinMargin = sf::microseconds(200);
+	static inline const sf::Time MaxSpinMargin = sf::milliseconds(4);
+
+private:
+	sf::Clock _clock;
+	sf::Time _period;
+	sf::Time _next;
+	sf::Time _spinMargin = sf::milliseconds(2);
+
+	Uint64 _frames = 0;
+	Uint64 _lateFrames = 0;
+	sf::Time _totalOvershoot;
+	sf::Time _maxOvershoot;
+
+public:
+	FramePacer() = default;
+	FramePacer(const FramePacer&) = delete;
+	FramePacer(FramePacer&&) noexcept = default;
+	~FramePacer() = default;
+
+	FramePacer& operator= (const FramePacer&) = delete;
+	FramePacer& operator= (FramePacer&&) noexcept = default;
+
+public:
+	// Zero disables pacing, waitFrame() then returns at once. //
+	void setRate(unsigned int framesPerSecond);
+
+	void reset();
+
+	// Waits for the next frame deadline. When a whole period has been missed the schedule restarts from now. //
+	void waitFrame();
+
+	void waitFor(sf::Time time);
+
+	FramePacingStats getStats() const;
+	void resetStats();
+
+public:
+	inline sf::Time getPeriod() const { return _period; }
+	inline bool isPaced() const { return _period > sf::Time::Zero; }
+
+private:
+	void waitUntil(sf::Time deadline);
+	void record(sf::Time overshoot);
+
+public:
+	// Refresh rate of the primary display, DefaultDisplayRate when it cannot be queried. //
+	static unsigned int getDisplayRate();
+};
@@ -1,6 +1,19 @@
 #include "game_controller.h"
 
+#include "animation_clock.h"
 #include "font.h"
+#include "jobs.h"
+#include "utils/logger.h"
+#include "utils/profiler.h"
+
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <typeinfo>
+#include <utility>
 
 
 GameController GameController::Instance{ "Puzzle Bubble Classics" };
@@ -8,45 +21,100 @@ GameController GameController::Instance{ "Puzzle Bubble Classics" };
 GameController::GameController(const std::string& name) :
 	_close(true),
 	_window(),
-	_deltaClock(),
 	_phClock(),
 	_phTimeCurrent(),
-	_phTimeUp(sf::seconds(1.f / MaxPhysicsFPS)),
+	_phTimeUp(sf::microseconds(1000000 / MaxPhysicsFPS)),
+	_phAlpha(0),
+	_tick(0),
+	_headless(false),
+	_headlessOptions(),
+	_playback(),
+	_playbackIndex(0),
+	_playbackStart(0),
+	_replayRestart(),
+	_pendingSeek(),
+	_stepping(false),
+	_clockHeld(false),
+	_clockRestarted(false),
+	_recording(false),
+	_recordStart(0),
+	_record(),
 	_name(name),
 	_vmode(1280, 720),
 	_wstyle(WindowStyle::Default),
-	_virtualCanvas(),
+	_canvases(),
+	_sharedCanvas(1),
+	_backCanvas(0),
+	_frontCanvas(2),
+	_renderThread(),
+	_renderPacer(),
+	_updatePacer(),
+	_frameRateCap(0),
+	_pacingMutex(),
+	_pacingStats(),
 	_virtualWindow(),
 	_view(),
+	_resolution(),
+	_canvasExtents(),
+	_presentBudget(sf::seconds(1.f / float(FramePacer::DefaultDisplayRate))),
+	_presentMicros(0),
+	_sceneDirty(true),
+	_idle(false),
+	_focused(true),
+	_presentRequested(false),
+	_skippedSnapshots(0),
+	_batchTotals(),
+	_snapshots(0),
 	_activities(),
+	_parallelActivities(),
+	_parallelUpdate(true),
 	_fps()
 {
-	_virtualCanvas.create(CanvasWidth, CanvasHeight);
-
 	_virtualWindow.setSize({ static_cast<float>(CanvasWidth), static_cast<float>(CanvasHeight) });
 	_virtualWindow.setPosition(0, 0);
-	_virtualWindow.setTexture(&_virtualCanvas.getTexture());
 
 	_view.setSize({ static_cast<float>(CanvasWidth), static_cast<float>(CanvasHeight) });
 	_view.setCenter({ static_cast<float>(CanvasWidth / 2), static_cast<float>(CanvasHeight / 2) });
 }
-GameController::~GameController() {}
+GameController::~GameController() { stopRenderThread(); }
 
-void GameController::start()
+void GameController::setHeadless(HeadlessOptions options)
+{
+	if (!_close)
+	{
+		logger::warn("GameController: Headless mode has to be set before opening.");
+		return;
+	}
+
+	_headless = true;
+	_headlessOptions = std::move(options);
+
+	_playback = _headlessOptions.input;
+	_playbackIndex = 0;
+	_playbackStart = _tick;
+}
+
+void GameController::open()
 {
 	if (_close)
 	{
 		_close = false;
 		init();
-		loop();
 	}
 }
 
+void GameController::start()
+{
+	open();
+	loop();
+}
+
 void GameController::close()
 {
 	if (!_close)
 	{
 		_close = true;
+		stopRenderThread();
 		_window.close();
 	}
 }
@@ -63,17 +131,45 @@ void GameController::setWindowStyle(WindowStyle style, bool apply)
 	if (apply)
 		resetWindow();
 }
+void GameController::setFrameRateCap(unsigned int framesPerSecond, bool apply)
+{
+	_frameRateCap = framesPerSecond;
+	if (apply)
+		resetWindow();
+}
+void GameController::setResolutionScaling(const ResolutionScalingSettings& settings, bool apply)
+{
+	_resolution.setSettings(settings);
+	if (apply)
+		resetWindow();
+}
 void GameController::resetWindow()
 {
-	if (_close)
+	if (_close || _headless)
 		return;
 
+	// The render thread owns the window context while it runs, it has to let it go first. //
+	const bool rendering = _renderThread.joinable();
+	stopRenderThread();
+
+	createCanvases();
+	_presentBudget = sf::seconds(1.f / float(_frameRateCap > 0 ? _frameRateCap : FramePacer::getDisplayRate()));
+
+	// Only the window is recreated, close() would also end the loop. //
 	if (_window.isOpen())
-		close();
+		_window.close();
 	_window.create(_vmode, _name.c_str(), static_cast<Uint32>(_wstyle));
 	//_window.setVerticalSyncEnabled(true);
 	_window.setFramerateLimit(0);
 	_window.setActive(true);
+
+	// A new window starts empty, the next snapshot is drawn and presented whatever the activities report. //
+	_focused = _window.hasFocus();
+	_sceneDirty = true;
+	_presentRequested = true;
+
+	if (rendering)
+		startRenderThread();
 }
 
 void GameController::addActivity(std::unique_ptr<GameActivity>&& activity)
@@ -83,76 +179,410 @@ void GameController::addActivity(std::unique_ptr<GameActivity>&& activity)
 
 void GameController::loop()
 {
+	PROFILE_THREAD("main");
+	if (_headless)
+	{
+		headlessLoop();
+		return;
+	}
+
+	startRenderThread();
 	while (!_close)
 	{
-		render();
 		update();
 		processEvents();
 	}
+	stopRenderThread();
+}
+
+void GameController::headlessLoop()
+{
+	std::ofstream hashLog;
+	if (_headlessOptions.stateHashEvery > 0)
+	{
+		hashLog.open(_headlessOptions.stateHashLog);
+		if (!hashLog)
+			logger::error("GameController: Cannot write state hashes to '{}'.", _headlessOptions.stateHashLog.string());
+	}
+
+	sf::Clock clock;
+	const sf::Time start = getSimulationTime();
+	while (!_close)
+	{
+		applySeek();
+		step();
+
+		if (_headlessOptions.renderEvery > 0 && _tick % _headlessOptions.renderEvery == 0)
+			renderSnapshot();
+
+		if (hashLog && _headlessOptions.stateHashEvery > 0 && _tick % _headlessOptions.stateHashEvery == 0)
+			hashLog << _tick << ' ' << getStateHash() << '\n';
+
+		const sf::Time simulated = getSimulationTime() - start;
+		if (_headlessOptions.duration > sf::Time::Zero && simulated >= _headlessOptions.duration)
+			_close = true;
+		else if (_headlessOptions.speed > 0)
+			_updatePacer.waitFor(simulated / _headlessOptions.speed - clock.getElapsedTime());
+	}
+
+	if (_snapshots > 0)
+	{
+		std::cout << std::format("Headless: {} snapshots drew {} batched sprites in {} draw calls.",
+			_snapshots, _batchTotals.quads, _batchTotals.drawCalls) << std::endl;
+	}
 }
 
 void GameController::init()
 {
+	if (_headless)
+	{
+		// Offscreen canvases need a GL context, headless runs that never render avoid it. //
+		if (_headlessOptions.renderEvery > 0)
+			createCanvases();
+		return;
+	}
+
+	createCanvases();
 	_fps.init();
 	_fps.enabled(true);
 	resetWindow();
 }
 
-void GameController::update()
+void GameController::createCanvases()
 {
-	static sf::Time currentTime = sf::Time::Zero;
-	static unsigned int currentFps = 0;
+	const sf::Vector2u base = { Uint32(CanvasWidth), Uint32(CanvasHeight) };
+	const float capacity = _headless ? 1.f : _resolution.getCapacity(base, getSize());
+	const sf::Vector2u size = {
+		Uint32(std::ceil(float(CanvasWidth) * capacity)),
+		Uint32(std::ceil(float(CanvasHeight) * capacity))
+	};
+	_resolution.setLimit(capacity);
+
+	for (std::size_t i = 0; i < SnapshotCount; ++i)
+	{
+		sf::RenderTexture& canvas = _canvases[i];
+		_canvasExtents[i] = _resolution.getExtent(base);
+		if (canvas.getSize() == size)
+			continue;
+
+		if (!canvas.create(size.x, size.y))
+			logger::error("GameController: Cannot create a {}x{} canvas.", size.x, size.y);
+
+		// Canvases are scaled to the window whenever the resolution adapts. //
+		canvas.setSmooth(true);
+		canvas.clear();
+		canvas.display();
+	}
+
+	_virtualWindow.setTexture(&_canvases[_frontCanvas].getTexture());
+	_virtualWindow.setTextureRect({ 0, 0, int(_canvasExtents[_frontCanvas].x), int(_canvasExtents[_frontCanvas].y) });
+}
 
+void GameController::update()
+{
 	if (!_close)
 	{
+		applySeek();
+
+		// Idle and unfocused updates wait longer between batches of fixed steps, input wakes them on the next poll. //
+		const sf::Time interval = getTickInterval();
 		_phTimeCurrent += _phClock.restart();
+		if (_phTimeCurrent < interval)
+		{
+			_updatePacer.waitFor(interval - _phTimeCurrent);
+			return;
+		}
+
+		PROFILE_ZONE("update");
+		sf::Clock workClock;
+
+		// Spiral of death guard: after a long stall only the last MaxPhysicsCatchUpSteps, or a whole throttled interval, are simulated. //
+		const unsigned int maxSteps = std::max(MaxPhysicsCatchUpSteps, Uint32(std::ceil(interval / _phTimeUp)));
+		const sf::Time maxCatchUp = _phTimeUp * static_cast<sf::Int64>(maxSteps);
+		if (_phTimeCurrent > maxCatchUp)
+			_phTimeCurrent = maxCatchUp + (_phTimeCurrent % _phTimeUp);
 
-		if (_phTimeCurrent >= _phTimeUp)
+		// Activities that come to rest during these steps still have to show where they stopped. //
+		if (!areActivitiesIdle())
+			_sceneDirty = true;
+
+		unsigned int steps = 0;
+		while (_phTimeCurrent >= _phTimeUp && steps < maxSteps)
 		{
-			sf::Time delta = _deltaClock.restart();
+			step();
+			_phTimeCurrent -= _phTimeUp;
+			steps++;
+		}
 
-			currentTime += delta;
-			currentFps += 1;
-			if (currentTime >= sf::seconds(1))
-			{
-				currentTime = sf::Time::Zero;
-				unsigned int fps = currentFps;
-				currentFps = 0;
-				std::cout << "Physics fps: " << fps << std::endl;
-			}
+		if (AnimationClock::instance().consumeFrameRequest() || !areActivitiesIdle())
+			_sceneDirty = true;
+
+		_fps.resolveFont();
 
-			std::int64_t temp = static_cast<Int64>(_phTimeCurrent / _phTimeUp);
-			_phTimeCurrent -= _phTimeUp * temp;
-			updateActivities(delta);
+		// Nothing changed since the last snapshot, the render thread keeps it on screen. //
+		_idle = !_sceneDirty;
+		if (_idle)
+		{
+			_skippedSnapshots++;
+			return;
 		}
 
-		_fps.update();
+		// One snapshot per presented frame: until the render thread takes the last one, another would only replace it. //
+		if ((_sharedCanvas.load() & FreshSnapshot) != 0)
+			return;
+
+		const sf::Time updateTime = workClock.getElapsedTime();
+		_phAlpha = _phTimeCurrent / _phTimeUp;
+		_sceneDirty = false;
+		renderSnapshot();
+		const sf::Time renderTime = workClock.getElapsedTime() - updateTime;
+		_fps.recordUpdate(updateTime, renderTime);
+		updateResolution(renderTime);
 	}
 }
 
-void GameController::render()
+void GameController::step()
 {
-	if (!_close)
+	PROFILE_ZONE("step");
+	dispatchScriptedEvents();
+	if (_close)
+		return;
+
+	_stepping = true;
+	updateActivities(_phTimeUp);
+	if (!std::exchange(_clockHeld, false))
+	{
+		AnimationClock::instance().advance(_phTimeUp);
+		_clockRestarted = false;
+	}
+	_tick++;
+	_stepping = false;
+}
+
+void GameController::dispatchScriptedEvents()
+{
+	const auto& events = _playback.getEvents();
+	for (; _playbackIndex < events.size() && _playbackStart + events[_playbackIndex].tick <= _tick; ++_playbackIndex)
+	{
+		const sf::Event& event = events[_playbackIndex].event;
+		if (event.type == sf::Event::Closed)
+		{
+			_close = true;
+			return;
+		}
+		processActivitiesEvents(event);
+	}
+}
+
+void GameController::startRecording(Replay replay)
+{
+	_record = std::move(replay);
+	_record.setStepTime(_phTimeUp);
+	_record.getInput().clear();
+	_recordStart = startReplayClock();
+	_recording = true;
+}
+
+Replay GameController::stopRecording()
+{
+	_recording = false;
+	return std::move(_record);
+}
+
+void GameController::startPlayback(const Replay& replay, std::function<void()> restart)
+{
+	if (replay.getStepTime() != _phTimeUp)
+		logger::warn("GameController: Replay step of {} us does not match {} us, playback will diverge.", replay.getStepTime().asMicroseconds(), _phTimeUp.asMicroseconds());
+
+	_playback = replay.getInput();
+	_playbackIndex = 0;
+	_playbackStart = startReplayClock();
+	_replayRestart = std::move(restart);
+}
+
+void GameController::stopPlayback()
+{
+	_playback.clear();
+	_playbackIndex = 0;
+	_replayRestart = {};
+}
+
+void GameController::applySeek()
+{
+	if (!_pendingSeek.has_value())
+		return;
+
+	PROFILE_ZONE("seek");
+	const Uint64 target = _playbackStart + *_pendingSeek;
+	_pendingSeek.reset();
+
+	if (target < _tick)
+	{
+		if (!_replayRestart)
+		{
+			logger::warn("GameController: Cannot seek backwards without a replay restart callback.");
+			return;
+		}
+
+		_activities.clear();
+		_tick = _playbackStart;
+		_playbackIndex = 0;
+		AnimationClock::instance().reset();
+		_clockRestarted = true;
+		_replayRestart();
+	}
+
+	while (_tick < target && !_close)
+		step();
+	markSceneDirty();
+
+	// The re-simulated time must not be caught up again by the fixed step loop. //
+	_phTimeCurrent = sf::Time::Zero;
+	_phClock.restart();
+}
+
+Uint64 GameController::startReplayClock()
+{
+	// Timers armed since the last restart already belong to this replay. //
+	if (!_clockRestarted)
+	{
+		AnimationClock::instance().reset();
+		_clockRestarted = true;
+	}
+
+	// Activities created during a step first update in the next one, which is where the replay begins. //
+	if (_stepping)
 	{
-		_window.clear();
-		_virtualCanvas.clear();
+		_clockHeld = true;
+		return _tick + 1;
+	}
+	return _tick;
+}
+
+void GameController::renderSnapshot()
+{
+	PROFILE_ZONE("render");
+	sf::RenderTexture& canvas = _canvases[_backCanvas];
+	const sf::Vector2u size = canvas.getSize();
+	const sf::Vector2u scaled = _resolution.getExtent({ Uint32(CanvasWidth), Uint32(CanvasHeight) });
+	const sf::Vector2u extent = { std::min(size.x, scaled.x), std::min(size.y, scaled.y) };
+
+	sf::View view({ 0.f, 0.f, float(CanvasWidth), float(CanvasHeight) });
+	view.setViewport({ 0.f, 0.f, float(extent.x) / float(size.x), float(extent.y) / float(size.y) });
+	canvas.setView(view);
+	_canvasExtents[_backCanvas] = extent;
+
+	canvas.clear();
+	SpriteBatch::resetTotals();
+	renderActivities(canvas, sf::RenderStates::Default);
+	canvas.display();
+
+	const SpriteBatchStats& batches = SpriteBatch::totals();
+	_batchTotals.quads += batches.quads;
+	_batchTotals.drawCalls += batches.drawCalls;
+	_snapshots++;
+	_fps.recordBatches(batches);
+
+	// The render thread samples this texture from its own context. //
+	glFlush();
+
+	_backCanvas = _sharedCanvas.exchange(_backCanvas | FreshSnapshot) & SnapshotIndexMask;
+}
+
+void GameController::updateResolution(sf::Time render)
+{
+	if (_headless)
+		return;
+
+	// Only the snapshot and its present depend on the resolution, each of them has to fit in a presented frame. //
+	const float renderLoad = render / _presentBudget;
+	const float presentLoad = sf::microseconds(_presentMicros.load(std::memory_order_relaxed)) / _presentBudget;
+	if (_resolution.record(std::max(renderLoad, presentLoad)))
+		markSceneDirty();
+}
+
+sf::Time GameController::getTickInterval() const
+{
+	if (!_focused)
+		return std::max(_phTimeUp, sf::seconds(1.f / float(BackgroundTickRate)));
+	if (_idle && !_sceneDirty)
+		return std::max(_phTimeUp, sf::seconds(1.f / float(IdleTickRate)));
+	return _phTimeUp;
+}
 
-		renderActivities(_virtualCanvas, sf::RenderStates::Default);
+bool GameController::areActivitiesIdle() const
+{
+	return std::ranges::all_of(_activities, [](const auto& activity) { return !activity->isValid() || activity->isIdle(); });
+}
 
-		_virtualCanvas.display();
+void GameController::startRenderThread()
+{
+	if (_renderThread.joinable() || !_window.isOpen())
+		return;
 
-		_window.setView(_view);
-		_window.draw(_virtualWindow);
-		_window.setView(_window.getDefaultView());
+	_window.setActive(false);
+	_renderThread = std::jthread([this](std::stop_token stop) { renderLoop(stop); });
+}
 
-		_fps.render(_window);
+void GameController::stopRenderThread()
+{
+	if (!_renderThread.joinable())
+		return;
 
-		_window.display();
+	_renderThread.request_stop();
+	_renderThread.join();
+	_renderThread = {};
+}
+
+void GameController::renderLoop(std::stop_token stop)
+{
+	PROFILE_THREAD("render");
+	_window.setActive(true);
+	_renderPacer.setRate(_frameRateCap > 0 ? _frameRateCap : FramePacer::getDisplayRate());
+	_renderPacer.resetStats();
+	while (!stop.stop_requested())
+	{
+		_renderPacer.waitFrame();
+
+		const bool fresh = (_sharedCanvas.load() & FreshSnapshot) != 0;
+		if (fresh)
+			_frontCanvas = _sharedCanvas.exchange(_frontCanvas) & SnapshotIndexMask;
+
+		// Without a fresh snapshot the window keeps its last frame, unless it was resized, exposed or its overlay changed. //
+		if (!fresh && !_presentRequested.exchange(false))
+			continue;
+		present();
+
+		std::scoped_lock lock(_pacingMutex);
+		_pacingStats = _renderPacer.getStats();
 	}
+	_window.setActive(false);
+}
+
+void GameController::present()
+{
+	PROFILE_ZONE("present");
+	sf::Clock start;
+	_window.clear();
+
+	const sf::Vector2u& extent = _canvasExtents[_frontCanvas];
+	_virtualWindow.setTexture(&_canvases[_frontCanvas].getTexture());
+	_virtualWindow.setTextureRect({ 0, 0, int(extent.x), int(extent.y) });
+	_window.setView(_view);
+	_window.draw(_virtualWindow);
+	_window.setView(_window.getDefaultView());
+
+	_fps.update();
+	_fps.render(_window);
+
+	_window.display();
+	_presentMicros.store(start.getElapsedTime().asMicroseconds(), std::memory_order_relaxed);
+	_fps.recordPresent(start.getElapsedTime());
 }
 
 void GameController::processEvents()
 {
+	PROFILE_ZONE("processEvents");
 	if (!_close)
 	{
 		sf::Event event;
@@ -163,27 +593,71 @@ void GameController::processEvents()
 				_close = true;
 				return;
 			}
-			processActivitiesEvents(event);
+			if (event.type == sf::Event::KeyPressed && event.key.code == ProfilerDumpKey)
+				profiler::writeChromeTrace(Path(std::format("trace-{}.json", _tick)));
+			else if (event.type == sf::Event::KeyPressed && event.key.code == FrameStatsKey)
+				_fps.toggleDetail(), _presentRequested = true;
+			else if (event.type == sf::Event::KeyPressed && event.key.code == FrameStatsDumpKey)
+				_fps.requestDump();
+
+			if (event.type == sf::Event::LostFocus || event.type == sf::Event::GainedFocus)
+				_focused = event.type == sf::Event::GainedFocus;
+			if (event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus)
+				_presentRequested = true;
+
+			// Live input is ignored while a replay drives the activities. //
+			if (!isPlayingBack())
+				processActivitiesEvents(event);
 		}
 	}
 }
 
 void GameController::updateActivities(const sf::Time& elapsedTime)
 {
-	for (auto it = _activities.begin(); it != _activities.end(); it++)
+	_parallelActivities.clear();
+	for (auto it = _activities.begin(); it != _activities.end();)
 	{
 		auto& activity = *it;
 		if (activity->isDisposed())
+		{
+			_sceneDirty = true;
 			it = _activities.erase(it);
-		else
+			continue;
+		}
+
+		if (!activity->isInitiated())
+			activity->init(), activity->markAsInitiated(), _sceneDirty = true;
+
+		if (_parallelUpdate && activity->isParallelUpdateSafe())
+			_parallelActivities.push_back(activity.get());
+		++it;
+	}
+
+	// Serial activities run on this thread while the parallel ones are spread over the workers. //
+	JobSystem& jobs = JobSystem::instance();
+	JobGroup group;
+	for (GameActivity* activity : _parallelActivities)
+		jobs.run(group, [activity, &elapsedTime]() {
+			PROFILE_ZONE(typeid(*activity).name());
+			activity->update(elapsedTime);
+		});
+
+	// Activities created during this step start on the next one. //
+	for (auto& activity : _activities)
+		if (activity->isInitiated() && !(_parallelUpdate && activity->isParallelUpdateSafe()))
 		{
-			if (!activity->isInitiated())
-				activity->init(), activity->markAsInitiated();
+			PROFILE_ZONE(typeid(*activity).name());
 			activity->update(elapsedTime);
-			if (activity->isDisposed())
-				it = _activities.erase(it);
 		}
-	}
+
+	jobs.wait(group);
+
+	for (auto& activity : _activities)
+		if (activity->isInitiated())
+			activity->synchronize();
+
+	if (std::erase_if(_activities, [](const auto& activity) { return activity->isDisposed(); }) > 0)
+		_sceneDirty = true;
 }
 
 void GameController::renderActivities(sf::RenderTarget& canvas, sf::RenderStates rs)
@@ -196,8 +670,26 @@ void GameController::renderActivities(sf::RenderTarget& canvas, sf::RenderStates
 	}
 }
 
+Uint64 GameController::getStateHash() const
+{
+	Uint64 hash = 0xcbf29ce484222325;
+	for (const auto& activity : _activities)
+	{
+		if (!activity->isValid())
+			continue;
+
+		hash ^= activity->getStateHash() + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+	}
+	return hash;
+}
+
 void GameController::processActivitiesEvents(const sf::Event& event)
 {
+	if (_recording && _tick >= _recordStart && Replay::isRecordable(event))
+		_record.getInput().add(_tick - _recordStart, event);
+
+	markSceneDirty();
+
 	for (auto it = _activities.begin(); it != _activities.end(); it++)
 	{
 		auto& activity = *it;
@@ -213,18 +705,47 @@ void FPSMonitor::init()
 	_clock.restart();
 
 	_text.setFillColor(sf::Color::Green);
-	_text.setCharacterSize(24);
 
-	_text.setFont(*FontManager::instance().get("arial"));
+	resolveFont();
 
 	_text.setPosition(10, 10);
 
 	_text.setString("0 fps");
+
+	_statsText.setFillColor(sf::Color::White);
+	_statsText.setPosition(10, 44);
+
+	_graph.setPrimitiveType(sf::Quads);
+}
+
+void FPSMonitor::resolveFont()
+{
+	// Fonts may still be loading in background when the controller starts. //
+	if (_font != nullptr)
+		return;
+
+	_font = FontManager::instance().get(FontName);
+	if (_font != nullptr)
+		_pendingFont = _font.get();
+}
+
+void FPSMonitor::recordUpdate(sf::Time update, sf::Time render)
+{
+	_updateMicros.store(update.asMicroseconds(), std::memory_order_relaxed);
+	_renderMicros.store(render.asMicroseconds(), std::memory_order_relaxed);
+}
+
+void FPSMonitor::recordBatches(const SpriteBatchStats& snapshot)
+{
+	_batchedSprites.store(snapshot.quads, std::memory_order_relaxed);
+	_batchDrawCalls.store(snapshot.drawCalls, std::memory_order_relaxed);
 }
 
 void FPSMonitor::update()
 {
 	sf::Time delta = _clock.restart();
+	_frameTime = delta;
+	_sinceStats += delta;
 
 	_remaining -= static_cast<Int64>(delta.asMicroseconds());
 	_current++;
@@ -237,11 +758,154 @@ void FPSMonitor::update()
 
 		_text.setString(std::to_string(_last) + " fps");
 	}
+
+	if (_textFont == nullptr)
+	{
+		// The font is handed over directly, the font manager belongs to the update thread. //
+		_textFont = _pendingFont.load();
+		if (_textFont != nullptr)
+		{
+			_text.setFont(BitmapFontManager::instance().bake(FontName, *_textFont, TextSize));
+			_statsText.setFont(BitmapFontManager::instance().bake(FontName, *_textFont, StatsTextSize));
+		}
+	}
 }
 void FPSMonitor::render(sf::RenderTarget& canvas)
 {
-	if (_enabled)
+	if (_enabled && _textFont != nullptr)
 	{
 		canvas.draw(_text);
+
+		if (_detailed)
+		{
+			if (_sinceStats >= StatsRefresh)
+				refreshStats();
+
+			buildGraph({ 10.f, static_cast<float>(canvas.getSize().y) - 10.f });
+			canvas.draw(_graph);
+			canvas.draw(_statsText);
+		}
 	}
 }
+
+void FPSMonitor::recordPresent(sf::Time present)
+{
+	_timings[_timingHead] = {
+		_frameTime,
+		sf::microseconds(_updateMicros.load(std::memory_order_relaxed)),
+		sf::microseconds(_renderMicros.load(std::memory_order_relaxed)),
+		present
+	};
+	_timingHead = (_timingHead + 1) % TimingCapacity;
+	_timingCount = std::min(_timingCount + 1, TimingCapacity);
+
+	if (_dumpRequested.exchange(false))
+		writeCsv(Path(std::format("frametimes-{}.csv", _dumps++)));
+}
+
+FrameTimeStats FPSMonitor::computeStats() const
+{
+	std::vector<Int64> frames;
+	frames.reserve(_timingCount);
+
+	sf::Time covered;
+	for (std::size_t i = 0; i < _timingCount && covered < StatsWindow; ++i)
+	{
+		const FrameTiming& timing = _timings[(_timingHead + TimingCapacity - 1 - i) % TimingCapacity];
+		frames.push_back(timing.frame.asMicroseconds());
+		covered += timing.frame;
+	}
+
+	FrameTimeStats stats;
+	stats.samples = frames.size();
+	if (frames.empty())
+		return stats;
+
+	std::sort(frames.begin(), frames.end());
+	const auto percentile = [&frames](std::size_t percent) {
+		const std::size_t rank = (frames.size() * percent + 99) / 100;
+		return sf::microseconds(frames[std::max<std::size_t>(rank, 1) - 1]);
+	};
+
+	stats.p50 = percentile(50);
+	stats.p95 = percentile(95);
+	stats.p99 = percentile(99);
+	stats.max = sf::microseconds(frames.back());
+	return stats;
+}
+
+bool FPSMonitor::writeCsv(const Path& path) const
+{
+	std::ofstream os(path);
+	if (!os)
+	{
+		logger::error("FPSMonitor: Cannot write frame times to '{}'.", path.string());
+		return false;
+	}
+
+	os << "frame_ms,update_ms,render_ms,present_ms\n";
+	for (std::size_t i = 0; i < _timingCount; ++i)
+	{
+		const FrameTiming& timing = _timings[(_timingHead + TimingCapacity - _timingCount + i) % TimingCapacity];
+		os << std::format("{:.3f},{:.3f},{:.3f},{:.3f}\n",
+			timing.frame.asSeconds() * 1000.f,
+			timing.update.asSeconds() * 1000.f,
+			timing.render.asSeconds() * 1000.f,
+			timing.present.asSeconds() * 1000.f
+		);
+	}
+	return true;
+}
+
+void FPSMonitor::refreshStats()
+{
+	_sinceStats = sf::Time::Zero;
+	_stats = computeStats();
+
+	const auto ms = [](sf::Time time) { return time.asSeconds() * 1000.f; };
+	_statsText.setString(std::format("p50 {:.2f} ms  p95 {:.2f} ms  p99 {:.2f} ms  max {:.2f} ms\n{} batched sprites in {} draw calls",
+		ms(_stats.p50), ms(_stats.p95), ms(_stats.p99), ms(_stats.max),
+		_batchedSprites.load(std::memory_order_relaxed), _batchDrawCalls.load(std::memory_order_relaxed)
+	));
+}
+
+void FPSMonitor::buildGraph(const sf::Vector2f& origin)
+{
+	static constexpr float BarWidth = 2;
+	static const sf::Color FrameColor = { 160, 160, 160, 120 };
+	static const sf::Color UpdateColor = { 80, 200, 80 };
+	static const sf::Color RenderColor = { 80, 120, 240 };
+	static const sf::Color PresentColor = { 240, 200, 60 };
+	static const sf::Color BudgetColor = { 240, 60, 60 };
+
+	const std::size_t samples = std::min(_timingCount, GraphSamples);
+	_graph.resize((samples * 4 + 1) * 4);
+
+	const auto height = [](sf::Time time) { return std::min(time / GraphScale, 1.f) * GraphHeight; };
+
+	std::size_t vertex = 0;
+	const auto quad = [this, &vertex](float left, float bottom, float width, float height, const sf::Color& color) {
+		_graph[vertex++] = sf::Vertex({ left, bottom - height }, color);
+		_graph[vertex++] = sf::Vertex({ left + width, bottom - height }, color);
+		_graph[vertex++] = sf::Vertex({ left + width, bottom }, color);
+		_graph[vertex++] = sf::Vertex({ left, bottom }, color);
+	};
+
+	// Oldest sample on the left. Work parts are stacked over the whole frame time. //
+	for (std::size_t i = 0; i < samples; ++i)
+	{
+		const FrameTiming& timing = _timings[(_timingHead + TimingCapacity - samples + i) % TimingCapacity];
+		const float left = origin.x + static_cast<float>(i) * BarWidth;
+		float bottom = origin.y;
+
+		quad(left, bottom, BarWidth, height(timing.frame), FrameColor);
+		quad(left, bottom, BarWidth, height(timing.update), UpdateColor);
+		bottom -= height(timing.update);
+		quad(left, bottom, BarWidth, height(timing.render), RenderColor);
+		bottom -= height(timing.render);
+		quad(left, bottom, BarWidth, height(timing.present), PresentColor);
+	}
+
+	// 60 fps budget line. //
+	quad(origin.x, origin.y - height(sf::microseconds(16667)), BarWidth * GraphSamples, 1, BudgetColor);
+}
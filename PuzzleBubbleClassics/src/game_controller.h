@@ -1,10 +1,24 @@
 #pragma once
 
 #include "object_basics.h"
+#include "frame_pacer.h"
+#include "input_script.h"
+#include "replay.h"
+#include "resolution_scaler.h"
+#include "sprite_batch.h"
+#include "text_renderer.h"
 #include "utils/reference.h"
 
+#include <array>
+#include <atomic>
+#include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 
 class GameController;
@@ -46,8 +60,40 @@ constexpr WindowStyle& operator|= (WindowStyle& left, WindowStyle right)
 }
 
 
+struct FrameTiming
+{
+	sf::Time frame;
+	sf::Time update;
+	sf::Time render;
+	sf::Time present;
+};
+
+struct FrameTimeStats
+{
+	sf::Time p50;
+	sf::Time p95;
+	sf::Time p99;
+	sf::Time max;
+	std::size_t samples = 0;
+};
+
+
 class FPSMonitor
 {
+public:
+	// About 17 seconds at 60 fps. //
+	static constexpr std::size_t TimingCapacity = 1024;
+	static constexpr std::size_t GraphSamples = 240;
+
+	static inline const sf::Time StatsWindow = sf::seconds(5);
+	static inline const sf::Time StatsRefresh = sf::milliseconds(250);
+	static inline const sf::Time GraphScale = sf::microseconds(33333);
+	static constexpr float GraphHeight = 100;
+
+	static constexpr std::string_view FontName = "arial";
+	static constexpr Uint32 TextSize = 24;
+	static constexpr Uint32 StatsTextSize = 16;
+
 private:
 	static constexpr Int64 identity = 1000000;
 
@@ -57,19 +103,85 @@ private:
 	unsigned int _last = 0;
 	bool _enabled = false;
 
-	sf::Text _text;
+	// Frame rates repeat, so most updates of the counter are hits of the glyph-run cache. //
+	BitmapText _text;
+
+	// Resolved on the update thread, handed to the render thread through _pendingFont. //
+	std::shared_ptr<sf::Font> _font;
+	std::atomic<const sf::Font*> _pendingFont = nullptr;
+	const sf::Font* _textFont = nullptr;
+
+	// Written by the update thread, sampled into each presented frame. //
+	std::atomic<Int64> _updateMicros = 0;
+	std::atomic<Int64> _renderMicros = 0;
+	std::atomic<Uint64> _batchedSprites = 0;
+	std::atomic<Uint64> _batchDrawCalls = 0;
+
+	// Render thread only. //
+	std::array<FrameTiming, TimingCapacity> _timings;
+	std::size_t _timingHead = 0;
+	std::size_t _timingCount = 0;
+	sf::Time _frameTime;
+	sf::Time _sinceStats;
+	FrameTimeStats _stats;
+	sf::VertexArray _graph;
+	BitmapText _statsText;
+
+	std::atomic<bool> _detailed = false;
+	std::atomic<bool> _dumpRequested = false;
+	unsigned int _dumps = 0;
 
 public:
 	void init();
 
+	// Update thread. //
+	void resolveFont();
+	void recordUpdate(sf::Time update, sf::Time render);
+	void recordBatches(const SpriteBatchStats& snapshot);
+
+	// Render thread. //
 	void update();
 	void render(sf::RenderTarget& canvas);
+	void recordPresent(sf::Time present);
+
+	// Frame time percentiles over the last StatsWindow. //
+	FrameTimeStats computeStats() const;
+	bool writeCsv(const Path& path) const;
+
+	// Any thread, applied by the render thread. //
+	inline void toggleDetail() { _detailed = !_detailed; }
+	inline void requestDump() { _dumpRequested = true; }
+
+private:
+	void buildGraph(const sf::Vector2f& origin);
+	void refreshStats();
+
+public:
 
 	inline bool enabled() const { return _enabled; }
 	inline void enabled(bool flag) { _enabled = flag; }
 };
 
 
+struct HeadlessOptions
+{
+	// Simulated seconds per real second. Zero runs as fast as possible. //
+	float speed = 0;
+
+	// Renders every Nth fixed step into the offscreen canvases. Zero never renders and creates no GL context. //
+	unsigned int renderEvery = 0;
+
+	// Every Nth fixed step the state hash is written to stateHashLog as "tick hash". Zero disables it. //
+	unsigned int stateHashEvery = 0;
+	Path stateHashLog;
+
+	// Simulated time after which the loop stops. Zero runs until close() or a scripted Closed event. //
+	sf::Time duration;
+
+	InputScript input;
+};
+
+
 class GameActivity : public GameObject
 {
 public:
@@ -100,6 +212,22 @@ private:
 
 public:
 	virtual constexpr void init() {}
+
+	/*
+		Parallel safe activities update concurrently and must only touch their own state in update().
+		They must not create, play or destroy random animated sprites there: those arm timers of the
+		AnimationClock, which only the update thread may do.
+	*/
+	virtual constexpr bool isParallelUpdateSafe() const { return false; }
+
+	// Serial sync point after every activity updated in a step, for effects across activities. //
+	virtual constexpr void synchronize() {}
+
+	// Digest of the simulation state, used to check parallel runs against serial ones. //
+	virtual constexpr Uint64 getStateHash() const { return 0; }
+
+	// Idle activities draw the same frame step after step, the controller stops redrawing while all of them are. //
+	virtual constexpr bool isIdle() const { return false; }
 };
 
 
@@ -111,27 +239,113 @@ public:
 
 	static constexpr unsigned int MaxPhysicsFPS = 240;
 
+	// Fixed steps run per update at most; time beyond that is dropped instead of piling up. //
+	static constexpr unsigned int MaxPhysicsCatchUpSteps = 8;
+
+	static constexpr std::size_t SnapshotCount = 3;
+
+	// Update rates while nothing changes on screen and while the window has no focus. //
+	static constexpr unsigned int IdleTickRate = 30;
+	static constexpr unsigned int BackgroundTickRate = 10;
+
+	// Writes the profiler zones to trace-<tick>.json. //
+	static constexpr sf::Keyboard::Key ProfilerDumpKey = sf::Keyboard::F11;
+
+	static constexpr sf::Keyboard::Key FrameStatsKey = sf::Keyboard::F3;
+	static constexpr sf::Keyboard::Key FrameStatsDumpKey = sf::Keyboard::F4;
+
+private:
+	static constexpr Uint8 SnapshotIndexMask = 0x3;
+	static constexpr Uint8 FreshSnapshot = 0x4;
+
 private:
 	static GameController Instance;
 
 private:
-	bool _close;
+	std::atomic<bool> _close;
 	sf::RenderWindow _window;
 
-	sf::Clock _deltaClock;
 	sf::Clock _phClock;
 	sf::Time _phTimeCurrent;
 	sf::Time _phTimeUp;
+	float _phAlpha;
+	Uint64 _tick;
+
+	bool _headless;
+	HeadlessOptions _headlessOptions;
+
+	// Scripted input (headless script or replay playback) is dispatched before the step of its tick. //
+	InputScript _playback;
+	std::size_t _playbackIndex;
+	Uint64 _playbackStart;
+	std::function<void()> _replayRestart;
+	std::optional<Uint64> _pendingSeek;
+
+	/*
+		Replays started inside a step begin with the next one: the clock is reset at once and that step
+		does not advance it. Until it advances again, a second start keeps the timers armed since then.
+	*/
+	bool _stepping;
+	bool _clockHeld;
+	bool _clockRestarted;
+
+	bool _recording;
+	Uint64 _recordStart;
+	Replay _record;
 
 	std::string _name;
 	sf::VideoMode _vmode;
 	WindowStyle _wstyle;
 
-	sf::RenderTexture _virtualCanvas;
+	/*
+		Triple buffered canvases. The update thread draws into the back one and swaps it with the shared
+		one, the render thread swaps the shared one with its front one whenever it is flagged as fresh.
+		A new snapshot is only drawn once the fresh one was taken, so at most one per presented frame.
+	*/
+	std::array<sf::RenderTexture, SnapshotCount> _canvases;
+	std::atomic<Uint8> _sharedCanvas;
+	Uint8 _backCanvas;
+	Uint8 _frontCanvas;
+	std::jthread _renderThread;
+
+	// Presentation runs at the display rate unless capped, the update thread sleeps between fixed steps. //
+	FramePacer _renderPacer;
+	FramePacer _updatePacer;
+	unsigned int _frameRateCap;
+	mutable std::mutex _pacingMutex;
+	FramePacingStats _pacingStats;
+
 	sf::RectangleShape _virtualWindow;
 	sf::View _view;
 
+	/*
+		Canvases are allocated for the highest scale the window can use and snapshots are drawn into the
+		top-left extent of the current one, with a view that keeps the CanvasWidth x CanvasHeight world.
+		Each extent is written with its snapshot and read back by the render thread when presenting it.
+	*/
+	ResolutionScaler _resolution;
+	std::array<sf::Vector2u, SnapshotCount> _canvasExtents;
+	sf::Time _presentBudget;
+	std::atomic<Int64> _presentMicros;
+
+	/*
+		Raised by input, window events and activity changes, and on every update while an activity is not
+		idle or an animation is playing. While it stays down no snapshot is drawn, the render thread keeps the
+		last frame on screen and updates slow down to IdleTickRate.
+	*/
+	bool _sceneDirty;
+	bool _idle;
+	bool _focused;
+	std::atomic<bool> _presentRequested;
+	Uint64 _skippedSnapshots;
+
+	// Sprite batching of every snapshot drawn so far, reported at the end of headless runs. //
+	SpriteBatchStats _batchTotals;
+	Uint64 _snapshots;
+
 	std::list<std::unique_ptr<GameActivity>> _activities;
+	std::vector<GameActivity*> _parallelActivities;
+	bool _parallelUpdate;
 
 	FPSMonitor _fps;
 
@@ -154,25 +368,118 @@ public:
 
 	inline sf::Vector2u getSize() const { return { _vmode.width, _vmode.height }; }
 
+	// Fraction of a fixed step left in the accumulator when the current snapshot is rendered. //
+	constexpr float getInterpolationAlpha() const { return _phAlpha; }
+
+	constexpr unsigned int getFrameRateCap() const { return _frameRateCap; }
+
+	inline sf::Time getStepTime() const { return _phTimeUp; }
+
+	// Fixed steps simulated since start. //
+	constexpr Uint64 getTick() const { return _tick; }
+	inline sf::Time getSimulationTime() const { return _phTimeUp * static_cast<sf::Int64>(_tick); }
+
+	constexpr bool isHeadless() const { return _headless; }
+
+	// Headless runs that never render have no GL context: textures, atlas pages and glyph pages are not created. //
+	constexpr bool hasGraphics() const { return !_headless || _headlessOptions.renderEvery > 0; }
+
+	constexpr bool isParallelUpdateEnabled() const { return _parallelUpdate; }
+	constexpr void setParallelUpdateEnabled(bool enabled) { _parallelUpdate = enabled; }
+
+	// Combined getStateHash() of the live activities, in activity order. //
+	Uint64 getStateHash() const;
+
+	constexpr bool isRecording() const { return _recording; }
+	constexpr Replay& getRecording() { return _record; }
+	inline bool isPlayingBack() const { return _playbackIndex < _playback.getEvents().size(); }
+
+	inline FramePacingStats getFramePacingStats() const
+	{
+		std::scoped_lock lock(_pacingMutex);
+		return _pacingStats;
+	}
+
+	// Update thread. //
+	inline ResolutionScalingStats getResolutionScalingStats() const { return _resolution.getStats(); }
+
+	// Update thread. Whether the last update skipped its snapshot, and how many were skipped so far. //
+	constexpr bool isIdle() const { return _idle; }
+	constexpr Uint64 getSkippedSnapshots() const { return _skippedSnapshots; }
+
+	// Update thread. Batched sprites and their draw calls over every snapshot drawn so far. //
+	constexpr const SpriteBatchStats& getBatchTotals() const { return _batchTotals; }
+	constexpr Uint64 getSnapshotCount() const { return _snapshots; }
+
 public:
+	// Must be called before open(). No window is created and activities run on a virtual clock. //
+	void setHeadless(HeadlessOptions options);
+
+	// Creates the window without entering the loop. start() calls it when needed. //
+	void open();
 	void start();
 
 	void close();
 
 	void setVideoMode(sf::VideoMode mode, bool apply = true);
 	void setWindowStyle(WindowStyle style, bool apply = true);
+
+	// Zero follows the display refresh rate. Takes effect on the next window reset. //
+	void setFrameRateCap(unsigned int framesPerSecond, bool apply = true);
+
+	// Canvases are reallocated for the new bounds on the next window reset. //
+	void setResolutionScaling(const ResolutionScalingSettings& settings, bool apply = true);
 	void resetWindow();
 
+	// Update thread. Draws a snapshot on the next update even if every activity is idle. //
+	inline void markSceneDirty() { _sceneDirty = true; }
+
 	void addActivity(std::unique_ptr<GameActivity>&& activity);
 
+	/*
+		Records every input event dispatched to the activities, stamped with the tick it applies to.
+		'replay' carries the random state captured at tick 0 (see Scenario::saveReplayState). Tick 0 is
+		the next step to run, and the animation clock restarts from zero there. Activities of the replay
+		are created after this call, so the timers of their animated sprites survive the restart; their
+		state can still be saved through getRecording().
+	*/
+	void startRecording(Replay replay);
+	Replay stopRecording();
+
+	/*
+		Plays the replay input back from the next step, live input no longer reaches the activities.
+		As with startRecording(), the activities of the replay are created after this call.
+		'restart' rebuilds the activities from the replay and is used to seek backwards, it runs with
+		the activities cleared and the animation clock back at zero.
+	*/
+	void startPlayback(const Replay& replay, std::function<void()> restart = {});
+	void stopPlayback();
+
+	// Re-simulates up to replay 'tick' without rendering before the next update. Seeking backwards needs the restart callback. //
+	inline void seek(Uint64 tick) { _pendingSeek = tick; }
+
 private:
 	void loop();
+	void headlessLoop();
 
 	void init();
+	void createCanvases();
 	void update();
-	void render();
+	void step();
+	void dispatchScriptedEvents();
+	void applySeek();
+	Uint64 startReplayClock();
+	void renderSnapshot();
+	void updateResolution(sf::Time render);
+	sf::Time getTickInterval() const;
+	bool areActivitiesIdle() const;
 	void processEvents();
 
+	void startRenderThread();
+	void stopRenderThread();
+	void renderLoop(std::stop_token stop);
+	void present();
+
 	void updateActivities(const sf::Time& elapsedTime);
 	void renderActivities(sf::RenderTarget& canvas, sf::RenderStates rs);
 	void processActivitiesEvents(const sf::Event& event);
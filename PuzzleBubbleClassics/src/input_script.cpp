@@ -0,0 +1,123 @@
+#include "input_script.h"
+
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <string_view>
+
+
+struct EventTypeName
+{
+	std::string_view name;
+	sf::Event::EventType type;
+};
+
+static constexpr EventTypeName EventTypeNames[] = {
+	{ "Closed", sf::Event::Closed },
+	{ "KeyPressed", sf::Event::KeyPressed },
+	{ "KeyReleased", sf::Event::KeyReleased },
+	{ "TextEntered", sf::Event::TextEntered },
+	{ "MouseMoved", sf::Event::MouseMoved },
+	{ "MouseButtonPressed", sf::Event::MouseButtonPressed },
+	{ "MouseButtonReleased", sf::Event::MouseButtonReleased }
+};
+
+
+static bool readEvent(const JsonValue& json, sf::Event& event)
+{
+	const std::string type = json.value("type", "");
+	auto it = std::find_if(std::begin(EventTypeNames), std::end(EventTypeNames), [&type](const EventTypeName& entry) { return entry.name == type; });
+	if (it == std::end(EventTypeNames))
+	{
+		logger::warn("Input script: Unsupported event type '{}'.", type);
+		return false;
+	}
+
+	event = {};
+	event.type = it->type;
+	switch (event.type)
+	{
+		case sf::Event::KeyPressed:
+		case sf::Event::KeyReleased:
+			event.key.code = static_cast<sf::Keyboard::Key>(json.value("code", static_cast<int>(sf::Keyboard::Unknown)));
+			event.key.alt = json.value("alt", false);
+			event.key.control = json.value("control", false);
+			event.key.shift = json.value("shift", false);
+			event.key.system = json.value("system", false);
+			break;
+
+		case sf::Event::TextEntered:
+			event.text.unicode = json.value("unicode", Uint32(0));
+			break;
+
+		case sf::Event::MouseMoved:
+			event.mouseMove.x = json.value("x", 0);
+			event.mouseMove.y = json.value("y", 0);
+			break;
+
+		case sf::Event::MouseButtonPressed:
+		case sf::Event::MouseButtonReleased:
+			event.mouseButton.button = static_cast<sf::Mouse::Button>(json.value("button", static_cast<int>(sf::Mouse::Left)));
+			event.mouseButton.x = json.value("x", 0);
+			event.mouseButton.y = json.value("y", 0);
+			break;
+
+		default:
+			break;
+	}
+
+	return true;
+}
+
+
+bool InputScript::load(const JsonValue& json, sf::Time tickTime)
+{
+	if (!json.is_array())
+	{
+		logger::error("Input script: Expected an array of events.");
+		return false;
+	}
+
+	try
+	{
+		for (const auto& entry : json)
+		{
+			if (!entry.is_object())
+				continue;
+
+			Uint64 tick = 0;
+			if (entry.contains("tick"))
+				tick = entry.at("tick").get<Uint64>();
+			else if (entry.contains("time") && tickTime > sf::Time::Zero)
+				tick = static_cast<Uint64>(sf::seconds(entry.at("time").get<float>()).asMicroseconds() / tickTime.asMicroseconds());
+
+			sf::Event event;
+			if (readEvent(entry, event))
+				add(tick, event);
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		logger::error("Input script: {}", ex.what());
+		return false;
+	}
+
+	return true;
+}
+
+bool InputScript::load(const Path& path, sf::Time tickTime)
+{
+	if (!utils::path::isFile(path))
+	{
+		logger::error("Input script: File '{}' not found.", path.string());
+		return false;
+	}
+
+	return load(json::read(path.string()), tickTime);
+}
+
+void InputScript::add(Uint64 tick, const sf::Event& event)
+{
+	auto it = std::upper_bound(_events.begin(), _events.end(), tick, [](Uint64 tick, const ScriptedEvent& scripted) { return tick < scripted.tick; });
+	_events.insert(it, { tick, event });
+}
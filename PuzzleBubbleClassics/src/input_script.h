@@ -0,0 +1,53 @@
+#pragma once
+
+#include "utils/json.h"
+#include "utils/path.h"
+#include "utils/rawtypes.h"
+
+#include <SFML/Window/Event.hpp>
+
+#include <vector>
+
+
+struct ScriptedEvent
+{
+	Uint64 tick = 0;
+	sf::Event event = {};
+};
+
+
+/*
+	Timed input for runs without a window. Each entry is an object with a "tick" (fixed step index)
+	or a "time" in seconds, a "type" named after sf::Event::EventType and the fields of that event:
+		KeyPressed/KeyReleased: "code", optional "alt", "control", "shift", "system"
+		MouseButtonPressed/MouseButtonReleased: "button", "x", "y"
+		MouseMoved: "x", "y"
+		TextEntered: "unicode"
+		Closed: no fields
+*/
+class InputScript
+{
+private:
+	std::vector<ScriptedEvent> _events;
+
+public:
+	InputScript() = default;
+	InputScript(const InputScript&) = default;
+	InputScript(InputScript&&) noexcept = default;
+	~InputScript() = default;
+
+	InputScript& operator= (const InputScript&) = default;
+	InputScript& operator= (InputScript&&) noexcept = default;
+
+public:
+	// Events are sorted by tick, entries with the same tick keep their order. //
+	bool load(const JsonValue& json, sf::Time tickTime);
+	bool load(const Path& path, sf::Time tickTime);
+
+	void add(Uint64 tick, const sf::Event& event);
+
+public:
+	inline const std::vector<ScriptedEvent>& getEvents() const { return _events; }
+	inline bool empty() const { return _events.empty(); }
+	inline void clear() { _events.clear(); }
+};
@@ -0,0 +1,190 @@
+#include "jobs.h"
+
+#include "utils/logger.h"
+#include "utils/profiler.h"
+
+#include <algorithm>
+
+
+static constexpr std::size_t NoWorker = std::size_t(-1);
+
+JobSystem JobSystem::Instance;
+
+thread_local std::size_t JobSystem::WorkerIndex = NoWorker;
+
+
+JobSystem::JobSystem() :
+	_workerCount(std::max(2u, std::thread::hardware_concurrency()) - 1)
+{}
+
+JobSystem::~JobSystem() { stop(); }
+
+void JobSystem::setWorkerCount(unsigned int count)
+{
+	stop();
+	_workerCount = count;
+}
+
+void JobSystem::run(JobGroup& group, Job job)
+{
+	if (isSerial())
+	{
+		invoke(job);
+		return;
+	}
+
+	start();
+	group._pending.fetch_add(1, std::memory_order_relaxed);
+
+	const std::size_t queue = WorkerIndex != NoWorker ? WorkerIndex : _queues.size() - 1;
+	{
+		std::scoped_lock lock(_queues[queue]->mutex);
+		_queues[queue]->tasks.push_back({ std::move(job), &group });
+	}
+	_queued.fetch_add(1, std::memory_order_release);
+
+	std::scoped_lock lock(_sleepMutex);
+	_wake.notify_one();
+}
+
+void JobSystem::wait(JobGroup& group)
+{
+	const std::size_t self = WorkerIndex != NoWorker ? WorkerIndex : _queues.size() - 1;
+	while (!group.isDone())
+	{
+		if (!tryRunOne(self))
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::parallelFor(std::size_t count, const std::function<void(std::size_t)>& action)
+{
+	if (count == 0)
+		return;
+
+	if (isSerial() || count == 1)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			invoke([&action, i]() { action(i); });
+		return;
+	}
+
+	JobGroup group;
+	for (std::size_t i = 1; i < count; ++i)
+		run(group, [&action, i]() { action(i); });
+	invoke([&action]() { action(0); });
+	wait(group);
+}
+
+void JobSystem::stop()
+{
+	std::scoped_lock startLock(_startMutex);
+	if (!_started.load(std::memory_order_acquire))
+		return;
+
+	for (auto& worker : _workers)
+		worker.request_stop();
+	{
+		std::scoped_lock lock(_sleepMutex);
+		_wake.notify_all();
+	}
+	_workers.clear();
+
+	// Jobs left behind are still owed to their groups. //
+	for (std::size_t i = 0; i < _queues.size(); ++i)
+		while (tryRunOne(i));
+
+	_queues.clear();
+	_started.store(false, std::memory_order_release);
+}
+
+void JobSystem::start()
+{
+	if (_started.load(std::memory_order_acquire))
+		return;
+
+	// The first run() may come from several threads at once (startup graph and resource loader). //
+	std::scoped_lock lock(_startMutex);
+	if (_started.load(std::memory_order_relaxed))
+		return;
+
+	for (unsigned int i = 0; i <= _workerCount; ++i)
+		_queues.push_back(std::make_unique<Queue>());
+	for (unsigned int i = 0; i < _workerCount; ++i)
+		_workers.emplace_back([this, i](std::stop_token stop) { workerLoop(stop, i); });
+	_started.store(true, std::memory_order_release);
+}
+
+void JobSystem::workerLoop(std::stop_token stop, std::size_t index)
+{
+	WorkerIndex = index;
+	PROFILE_THREAD("job worker");
+	while (!stop.stop_requested())
+	{
+		if (tryRunOne(index))
+			continue;
+
+		std::unique_lock lock(_sleepMutex);
+		_wake.wait(lock, stop, [this]() { return _queued.load(std::memory_order_acquire) > 0; });
+	}
+}
+
+bool JobSystem::tryRunOne(std::size_t self)
+{
+	Task task;
+	if (!pop(self, task))
+		return false;
+
+	execute(task);
+	return true;
+}
+
+bool JobSystem::pop(std::size_t self, Task& task)
+{
+	if (_queued.load(std::memory_order_acquire) == 0)
+		return false;
+
+	// Own queue from the back, keeps recently pushed (cache warm) work local. //
+	{
+		Queue& own = *_queues[self];
+		std::scoped_lock lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			_queued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	const std::size_t count = _queues.size();
+	for (std::size_t offset = 1; offset < count; ++offset)
+	{
+		Queue& victim = *_queues[(self + offset) % count];
+		std::scoped_lock lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			_queued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::execute(Task& task)
+{
+	PROFILE_ZONE("job");
+	invoke(task.job);
+
+	if (task.group != nullptr)
+		task.group->_pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::invoke(const Job& job)
+{
+	try { job(); }
+	catch (const std::exception& ex) { logger::error("Jobs: Uncaught exception: {}", ex.what()); }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "utils/rawtypes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/*
+	Counter shared by a set of jobs. JobSystem::wait() returns once every job run through
+	the group has finished.
+*/
+class JobGroup
+{
+public:
+	friend class JobSystem;
+
+private:
+	std::atomic<Uint32> _pending = 0;
+
+public:
+	JobGroup() = default;
+	JobGroup(const JobGroup&) = delete;
+	JobGroup(JobGroup&&) noexcept = delete;
+	~JobGroup() = default;
+
+	JobGroup& operator= (const JobGroup&) = delete;
+	JobGroup& operator= (JobGroup&&) noexcept = delete;
+
+public:
+	inline bool isDone() const { return _pending.load(std::memory_order_acquire) == 0; }
+};
+
+
+/*
+	Work stealing job system. Every worker owns a deque: it pushes and pops at the back, idle
+	workers steal from the front of the others. Jobs pushed from non worker threads go to a
+	shared queue. Waiting threads run pending jobs instead of blocking.
+	With zero workers every job runs inline, in submission order.
+*/
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+private:
+	struct Task
+	{
+		Job job;
+		JobGroup* group = nullptr;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+private:
+	static JobSystem Instance;
+
+	static thread_local std::size_t WorkerIndex;
+
+private:
+	// One queue per worker plus the shared one at the back. //
+	std::vector<std::unique_ptr<Queue>> _queues;
+	std::vector<std::jthread> _workers;
+	std::atomic<Uint32> _queued = 0;
+
+	std::mutex _sleepMutex;
+	std::condition_variable_any _wake;
+
+	std::mutex _startMutex;
+	std::atomic<bool> _started = false;
+	unsigned int _workerCount;
+
+public:
+	JobSystem(const JobSystem&) = delete;
+	JobSystem(JobSystem&&) noexcept = delete;
+
+	JobSystem& operator= (const JobSystem&) = delete;
+	JobSystem& operator= (JobSystem&&) noexcept = delete;
+
+private:
+	JobSystem();
+	~JobSystem();
+
+public:
+	// Applies on the next start. Zero makes the system serial. //
+	void setWorkerCount(unsigned int count);
+
+	void run(JobGroup& group, Job job);
+
+	// Helps running jobs until the group is done. //
+	void wait(JobGroup& group);
+
+	// Runs action(i) for every i in [0, count), the calling thread takes part. //
+	void parallelFor(std::size_t count, const std::function<void(std::size_t)>& action);
+
+	void stop();
+
+public:
+	constexpr unsigned int getWorkerCount() const { return _workerCount; }
+	constexpr bool isSerial() const { return _workerCount == 0; }
+
+private:
+	void start();
+	void workerLoop(std::stop_token stop, std::size_t index);
+
+	bool tryRunOne(std::size_t self);
+	bool pop(std::size_t self, Task& task);
+	void execute(Task& task);
+
+	// Serial and parallel runs share the same policy: exceptions escaping a job are logged, never propagated. //
+	static void invoke(const Job& job);
+
+public:
+	static constexpr JobSystem& instance() { return Instance; }
+};
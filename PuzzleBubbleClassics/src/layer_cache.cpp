@@ -0,0 +1,121 @@
+#include "layer_cache.h"
+
+#include "utils/logger.h"
+#include "utils/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// The cache holds premultiplied colours: alpha blending into a transparent texture already multiplied them. //
+static const sf::BlendMode PremultipliedAlpha = sf::BlendMode(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha);
+
+
+LayerCache::Layer* LayerCache::findLayer(std::string_view name)
+{
+	auto it = std::find_if(_layers.begin(), _layers.end(), [name](const Layer& layer) { return layer.name == name; });
+	return it == _layers.end() ? nullptr : std::addressof(*it);
+}
+
+void LayerCache::add(std::string_view name, Painter painter)
+{
+	if (Layer* layer = findLayer(name); layer != nullptr)
+		layer->painter = std::move(painter);
+	else
+		_layers.push_back({ std::string(name), std::move(painter), true });
+	_dirty = true;
+}
+
+void LayerCache::remove(std::string_view name)
+{
+	if (std::erase_if(_layers, [name](const Layer& layer) { return layer.name == name; }) > 0)
+		_dirty = true;
+}
+
+void LayerCache::setVisible(std::string_view name, bool visible)
+{
+	Layer* layer = findLayer(name);
+	if (layer != nullptr && layer->visible != visible)
+	{
+		layer->visible = visible;
+		_dirty = true;
+	}
+}
+
+void LayerCache::clear()
+{
+	_layers.clear();
+	_texture.reset();
+	_dirty = true;
+}
+
+bool LayerCache::rebuild(const sf::Vector2f& pixelScale)
+{
+	PROFILE_ZONE("LayerCache::rebuild");
+
+	const unsigned int maxSize = sf::Texture::getMaximumSize();
+	const unsigned int width = std::min(maxSize, unsigned(std::ceil(_bounds.width * pixelScale.x)));
+	const unsigned int height = std::min(maxSize, unsigned(std::ceil(_bounds.height * pixelScale.y)));
+	if (width == 0 || height == 0)
+		return false;
+
+	if (_texture == nullptr || _texture->getSize() != sf::Vector2u(width, height))
+	{
+		_texture = std::make_unique<sf::RenderTexture>();
+		if (!_texture->create(width, height))
+		{
+			logger::error("LayerCache: Cannot create a {}x{} render texture.", width, height);
+			_texture.reset();
+			return false;
+		}
+	}
+
+	_texture->setView(sf::View(_bounds));
+	_texture->clear(sf::Color::Transparent);
+	{
+		SpriteBatch::Scope batch(_batch, *_texture);
+		int index = 0;
+		for (const Layer& layer : _layers)
+		{
+			_batch.setLayer(index++);
+			if (layer.visible)
+				layer.painter(*_texture, sf::RenderStates::Default);
+		}
+	}
+	_texture->display();
+
+	const float left = _bounds.left;
+	const float top = _bounds.top;
+	const float right = left + _bounds.width;
+	const float bottom = top + _bounds.height;
+	_quad[0] = sf::Vertex({ left, top }, { 0.f, 0.f });
+	_quad[1] = sf::Vertex({ left, bottom }, { 0.f, float(height) });
+	_quad[2] = sf::Vertex({ right, top }, { float(width), 0.f });
+	_quad[3] = sf::Vertex({ right, bottom }, { float(width), float(height) });
+
+	_pixelScale = pixelScale;
+	_dirty = false;
+	_stats.rebuilds++;
+	return true;
+}
+
+void LayerCache::render(sf::RenderTarget& canvas, sf::RenderStates rs)
+{
+	if (_layers.empty())
+		return;
+
+	// Pixels per unit of the target, so the cache is never sampled below its screen resolution. //
+	const sf::View& view = canvas.getView();
+	const sf::Vector2f pixelScale = {
+		float(canvas.getSize().x) * view.getViewport().width / view.getSize().x * std::hypot(rs.transform.getMatrix()[0], rs.transform.getMatrix()[1]),
+		float(canvas.getSize().y) * view.getViewport().height / view.getSize().y * std::hypot(rs.transform.getMatrix()[4], rs.transform.getMatrix()[5])
+	};
+
+	if ((_dirty || pixelScale != _pixelScale || _texture == nullptr) && !rebuild(pixelScale))
+		return;
+
+	rs.texture = &_texture->getTexture();
+	rs.blendMode = PremultipliedAlpha;
+	canvas.draw(_quad, 4, sf::TriangleStrip, rs);
+	_stats.blits++;
+}
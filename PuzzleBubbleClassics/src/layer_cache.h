@@ -0,0 +1,88 @@
+#pragma once
+
+#include "sprite_batch.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+struct LayerCacheStats
+{
+	Uint64 rebuilds = 0;
+	Uint64 blits = 0;
+};
+
+
+/*
+	Static parts of a scene, painted once into a render texture and then drawn as a single quad.
+	Changes are not tracked: owners call invalidate() when a painted part changes (theme, gear step...).
+	A change of the target resolution is detected on render and rebuilds at the new pixel density.
+	Layers paint in the cache bounds coordinates, in the order they were added.
+*/
+class LayerCache
+{
+public:
+	using Painter = std::function<void(sf::RenderTarget&, sf::RenderStates)>;
+
+private:
+	struct Layer
+	{
+		std::string name;
+		Painter painter;
+		bool visible = true;
+	};
+
+private:
+	std::vector<Layer> _layers;
+	std::unique_ptr<sf::RenderTexture> _texture;
+	SpriteBatch _batch;
+	sf::FloatRect _bounds;
+	sf::Vector2f _pixelScale = { 0, 0 };
+	sf::Vertex _quad[4];
+	bool _dirty = true;
+	LayerCacheStats _stats;
+
+public:
+	LayerCache() = default;
+	LayerCache(const LayerCache&) = delete;
+	LayerCache(LayerCache&&) noexcept = default;
+	~LayerCache() = default;
+
+	LayerCache& operator= (const LayerCache&) = delete;
+	LayerCache& operator= (LayerCache&&) noexcept = default;
+
+public:
+	// Replaces the layer with the same name, keeping its place. //
+	void add(std::string_view name, Painter painter);
+	void remove(std::string_view name);
+	void setVisible(std::string_view name, bool visible);
+
+	void clear();
+
+	void render(sf::RenderTarget& canvas, sf::RenderStates rs);
+
+public:
+	inline void invalidate() { _dirty = true; }
+	constexpr bool isDirty() const { return _dirty; }
+
+	constexpr const sf::FloatRect& getBounds() const { return _bounds; }
+	inline void setBounds(const sf::FloatRect& bounds)
+	{
+		if (bounds != _bounds)
+			_bounds = bounds, _dirty = true;
+	}
+
+	inline bool isEmpty() const { return _layers.empty(); }
+
+	constexpr const LayerCacheStats& getStats() const { return _stats; }
+
+private:
+	Layer* findLayer(std::string_view name);
+
+	bool rebuild(const sf::Vector2f& pixelScale);
+};
@@ -26,6 +26,37 @@ void MetaGoals::setBubbleGoals(const MetaBubble& bubble, Uint32 timesToDestroy)
 
 
 
+MetaBubbleBoard::MetaBubbleBoard(BoardColumnStyle columnStyle) :
+	_board(),
+	_columnStyle(utils::level::validateColumnStyle(columnStyle))
+{
+	_board.resize(rowsCount());
+	for (Row& row : _board)
+		row.resize(getColumnsCount());
+}
+
+void MetaBubbleBoard::setColumnStyle(BoardColumnStyle columnStyle)
+{
+	_columnStyle = utils::level::validateColumnStyle(columnStyle);
+	for (Row& row : _board)
+		row.resize(getColumnsCount());
+}
+
+bool MetaBubbleBoard::insertBubble(RowIndex row, ColumnIndex column, const MetaBubble& bubble)
+{
+	if (row >= getRowsCount() || column >= utils::level::adaptColumnCountIfRowIsOdd(row, _columnStyle))
+	{
+		logger::error("Cannot insert bubble on MetaBubbleBoard invalid cell [{}, {}].", row, column);
+		return false;
+	}
+
+	_board[rowIndex(row)][columnIndex(column)] = bubble;
+	return true;
+}
+
+
+
+
 void RandomBubbleModelSelectorScores::setModelScore(const std::shared_ptr<BubbleModel>& model, ScoreType score)
 {
 	if (model != nullptr && model->isLoaded())
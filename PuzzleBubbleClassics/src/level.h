@@ -239,6 +239,9 @@ private:
 	Board _board;
 	BoardColumnStyle _columnStyle = BoardColumnStyle::Min;
 
+	// Rows the source data had, rows past getRowsCount() are not stored. //
+	std::size_t _sourceRows = 0;
+
 public:
 	MetaBubbleBoard() : MetaBubbleBoard(BoardColumnStyle::Min) {}
 	MetaBubbleBoard(const MetaBubbleBoard&) = default;
@@ -263,6 +266,10 @@ public:
 	constexpr RowCount getRowsCount() const { return rowsCount(); }
 	constexpr ColumnCount getColumnsCount() const { return columnsCount(_columnStyle); }
 
+	constexpr std::size_t getSourceRowsCount() const { return _sourceRows; }
+	constexpr void setSourceRowsCount(std::size_t rows) { _sourceRows = rows; }
+	constexpr bool hasDroppedRows() const { return _sourceRows > rowsCount(); }
+
 private:
 	static constexpr RowCount rowsCount() noexcept { return utils::level::VisibleRows; }
 	static constexpr ColumnCount columnsCount(BoardColumnStyle style) noexcept { return utils::level::columnStyleToColumns(style); }
@@ -531,6 +538,9 @@ public:
 	constexpr const std::string& getBackground() const { return _background; }
 	constexpr void setBackground(std::string_view background) { _background = background; }
 
+	constexpr const std::string& getMusic() const { return _music; }
+	constexpr void setMusic(std::string_view music) { _music = music; }
+
 	constexpr MetaGoals& getGoals() { return _goals; }
 	constexpr const MetaGoals& getGoals() const { return _goals; }
 };
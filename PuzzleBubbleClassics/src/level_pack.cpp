@@ -0,0 +1,255 @@
+#include "level_pack.h"
+
+#include "utils/logger.h"
+
+
+static std::optional<BubbleColor> colorFromName(std::string_view name)
+{
+	if (name == BubbleColor::Multicolor.name())
+		return BubbleColor::Multicolor;
+
+	for (BubbleColor color : BubbleColor::all())
+		if (color.name() == name)
+			return color;
+	return {};
+}
+
+static MetaBubble readMetaBubble(const JsonValue& json)
+{
+	if (json.is_string())
+	{
+		const std::string& text = json.get_ref<const std::string&>();
+		if (text.empty())
+			return {};
+
+		const std::size_t sep = text.find(':');
+		if (sep == std::string::npos)
+			return MetaBubble(text);
+
+		const std::string model = text.substr(0, sep);
+		const auto color = colorFromName(std::string_view(text).substr(sep + 1));
+		if (!color.has_value())
+		{
+			logger::warn("Level Pack: Unknown bubble color '{}'. Using random color instead.", text.substr(sep + 1));
+			return MetaBubble(model);
+		}
+		return MetaBubble(model, *color);
+	}
+
+	if (json.is_object() && json.contains("model") && json.at("model").is_string())
+	{
+		const std::string& model = json.at("model").get_ref<const std::string&>();
+		if (json.contains("color") && json.at("color").is_string())
+		{
+			const auto color = colorFromName(json.at("color").get_ref<const std::string&>());
+			if (color.has_value())
+				return MetaBubble(model, *color);
+		}
+		return MetaBubble(model);
+	}
+
+	return {};
+}
+
+static TimerMode timerModeFromName(std::string_view name)
+{
+	if (name == "none") return TimerMode::None;
+	if (name == "end") return TimerMode::End;
+	if (name == "turn_and_end") return TimerMode::TurnAndEnd;
+	return TimerMode::Turn;
+}
+
+static void readModelScores(const JsonValue& json, RandomBubbleModelSelectorScores& scores)
+{
+	if (!json.is_object())
+		return;
+
+	for (const auto& entry : json.items())
+	{
+		if (!entry.value().is_number_unsigned())
+			continue;
+
+		if (!BubbleModelManager::instance().contains(entry.key()))
+			logger::warn("Level Pack: Unknown bubble model '{}' on model selector.", entry.key());
+
+		scores.setModelScore(entry.key(), RandomBubbleModelSelectorScores::ScoreType(
+			utils::clamp(entry.value().get<Uint32>(), RandomBubbleModelSelectorScores::MinScore, RandomBubbleModelSelectorScores::MaxScore)
+		));
+	}
+}
+
+template <typename _Ty>
+static _Ty readOr(const JsonValue& json, std::string_view field, _Ty defaultValue)
+{
+	if (!json.contains(field))
+		return defaultValue;
+
+	try { return json.at(field).get<_Ty>(); }
+	catch (const JsonValue::exception&) { return defaultValue; }
+}
+
+
+
+bool LevelPack::load(const Path& path)
+{
+	clear();
+
+	std::ifstream is(path);
+	if (!is)
+	{
+		logger::error("Level Pack: Cannot open '{}' file.", path.string());
+		return false;
+	}
+
+	JsonValue json;
+	try { json = json::read(is); }
+	catch (const JsonValue::exception& ex)
+	{
+		logger::error("Level Pack '{}': Malformed json. {}", path.string(), ex.what());
+		return false;
+	}
+
+	if (!json.is_object() || !json.contains(LevelsField) || !json.at(LevelsField).is_array())
+	{
+		logger::error("Level Pack '{}': Expected object with '{}' array.", path.string(), LevelsField);
+		return false;
+	}
+
+	_path = path;
+	_name = readOr<std::string>(json, NameField, utils::path::getFileName(path, false));
+
+	const JsonValue& levels = json.at(LevelsField);
+	_levels.resize(levels.size());
+
+	bool result = true;
+	for (std::size_t i = 0; i < _levels.size(); ++i)
+		if (!loadLevel(levels.at(i), _levels[i], i))
+			result = false;
+
+	return result;
+}
+
+void LevelPack::clear()
+{
+	_name.clear();
+	_path.clear();
+	_levels.clear();
+}
+
+bool LevelPack::loadLevel(const JsonValue& json, LevelProperties& level, std::size_t index)
+{
+	if (!json.is_object())
+	{
+		logger::error("Level Pack '{}': Level {} is not an object.", _name, index);
+		return false;
+	}
+
+	level.setColumnStyle(utils::level::columnsToColumnStyle(readOr<ColumnCount>(json, "columns", ColumnCount(BoardColumnStyle::Min))));
+	level.setPlayerId(readOr<Uint8>(json, "player", 0) == 0 ? PlayerId::First : PlayerId::Second);
+	level.setClearBoardRequiredCount(readOr<Uint32>(json, "clear_boards_required", 0));
+	level.setInitialFilledRows(readOr<Uint32>(json, "initial_rows", 0));
+	level.setBubbleGenerationEnabled(readOr<bool>(json, "generate_up", false));
+	level.setRoofEnabled(readOr<bool>(json, "roof", false));
+	level.setRemoteBubblesEnabled(readOr<bool>(json, "remote", false));
+	level.setHideTimer(readOr<bool>(json, "hide_timer", true));
+	level.setTimerTurnTime(readOr<Uint32>(json, "timer_turn", 10));
+	level.setTimerEndTime(readOr<Uint32>(json, "timer_end", 90));
+	level.setTimerMode(timerModeFromName(readOr<std::string>(json, "timer_mode", "turn")));
+	level.setBubbleSwapEnabled(readOr<bool>(json, "swap", true));
+	level.setBackground(readOr<std::string>(json, "background", ""));
+	level.setMusic(readOr<std::string>(json, "music", ""));
+
+	const RNG::SeedType seed = readOr<RNG::SeedType>(json, "seed", 0);
+	if (seed == 0)
+		level.setSeedRandom();
+	else
+		level.setSeed(seed);
+
+	if (json.contains("hidden") && json.at("hidden").is_object())
+	{
+		const JsonValue& hidden = json.at("hidden");
+		level.setHiddenBubbleContainerType({
+			readOr<bool>(hidden, "discrete", false),
+			readOr<bool>(hidden, "random", false),
+			readOr<bool>(hidden, "endless", false)
+		});
+	}
+
+	if (json.contains("colors") && json.at("colors").is_array())
+	{
+		for (BubbleColor color : BubbleColor::all())
+			level.setColorEnabled(color, false);
+
+		for (const JsonValue& jcolor : json.at("colors"))
+		{
+			const auto color = jcolor.is_string() ? colorFromName(jcolor.get_ref<const std::string&>()) : std::nullopt;
+			if (color.has_value())
+				level.setColorEnabled(*color, true);
+			else
+				logger::warn("Level Pack '{}': Level {} has invalid available color {}.", _name, index, jcolor.dump());
+		}
+	}
+
+	if (json.contains("arrow_models"))
+		readModelScores(json.at("arrow_models"), level.getArrowModelSelectorScores());
+	if (json.contains("board_models"))
+		readModelScores(json.at("board_models"), level.getBoardModelSelector());
+
+	if (json.contains("boards") && json.at("boards").is_array())
+	{
+		const JsonValue& boards = json.at("boards");
+		level.setBubbleBoardCount(boards.size());
+		for (std::size_t b = 0; b < boards.size(); ++b)
+		{
+			MetaBubbleBoard& board = level.getBubbleBoard(b);
+			board.setColumnStyle(level.getColumnStyle());
+
+			const JsonValue& rows = boards.at(b);
+			if (!rows.is_array())
+				continue;
+
+			// Extra rows cannot be stored, the validator reports them as too-many-rows. //
+			board.setSourceRowsCount(rows.size());
+			if (board.hasDroppedRows())
+				logger::error("Level Pack '{}': Level {} board {} has {} rows. Only {} are allowed.", _name, index, b, rows.size(), board.getRowsCount());
+
+			const RowCount rowCount = RowCount(std::min(rows.size(), std::size_t(board.getRowsCount())));
+			for (RowIndex r = 0; r < rowCount; ++r)
+			{
+				if (!rows.at(r).is_array())
+					continue;
+
+				// Cells are stored as they come so the validator can report invalid columns. //
+				const JsonValue& cells = rows.at(r);
+				MetaBubbleBoard::Row& row = board.getRow(r);
+				if (cells.size() > row.size())
+					row.resize(cells.size());
+
+				for (ColumnIndex c = 0; c < ColumnIndex(cells.size()); ++c)
+					row[c] = readMetaBubble(cells.at(c));
+			}
+		}
+	}
+
+	if (json.contains("goals") && json.at("goals").is_object())
+	{
+		const JsonValue& goals = json.at("goals");
+		level.getGoals().setTimesToClearBoard(readOr<Uint32>(goals, "clear_board_times", 0));
+
+		if (goals.contains("bubbles") && goals.at("bubbles").is_array())
+		{
+			for (const JsonValue& goal : goals.at("bubbles"))
+			{
+				const MetaBubble bubble = goal.is_object() && goal.contains("bubble") ? readMetaBubble(goal.at("bubble")) : MetaBubble();
+				if (!bubble)
+				{
+					logger::warn("Level Pack '{}': Level {} has invalid bubble goal {}.", _name, index, goal.dump());
+					continue;
+				}
+				level.getGoals().setBubbleGoals(bubble, readOr<Uint32>(goal, "count", 1));
+			}
+		}
+	}
+
+	return true;
+}
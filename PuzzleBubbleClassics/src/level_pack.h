@@ -0,0 +1,48 @@
+#pragma once
+
+#include "level.h"
+
+#include "utils/json.h"
+#include "utils/path.h"
+
+
+class LevelPack
+{
+private:
+	static constexpr std::string_view NameField = "name";
+	static constexpr std::string_view LevelsField = "levels";
+
+private:
+	std::string _name;
+	Path _path;
+	std::vector<LevelProperties> _levels;
+
+public:
+	LevelPack() = default;
+	LevelPack(const LevelPack&) = default;
+	LevelPack(LevelPack&&) noexcept = default;
+	~LevelPack() = default;
+
+	LevelPack& operator= (const LevelPack&) = default;
+	LevelPack& operator= (LevelPack&&) noexcept = default;
+
+public:
+	bool load(const Path& path);
+
+	void clear();
+
+public:
+	constexpr const std::string& getName() const { return _name; }
+	constexpr const Path& getPath() const { return _path; }
+
+	constexpr std::size_t getLevelCount() const { return _levels.size(); }
+	constexpr bool empty() const { return _levels.empty(); }
+
+	constexpr LevelProperties& getLevel(std::size_t index) { return _levels[index]; }
+	constexpr const LevelProperties& getLevel(std::size_t index) const { return _levels[index]; }
+
+	constexpr const std::vector<LevelProperties>& getLevels() const { return _levels; }
+
+private:
+	bool loadLevel(const JsonValue& json, LevelProperties& level, std::size_t index);
+};
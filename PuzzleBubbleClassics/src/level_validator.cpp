@@ -0,0 +1,668 @@
+#include "level_validator.h"
+
+#include "utils/logger.h"
+#include "utils/profiler.h"
+#include "utils/str.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+
+bool LevelReport::isValid() const
+{
+	// Solver results count through the issues they raised, inconclusive ones are only warnings. //
+	for (const LevelIssue& issue : issues)
+		if (issue.severity == LevelIssueSeverity::Error)
+			return false;
+	return true;
+}
+
+bool LevelPackReport::isValid() const
+{
+	if (!loaded)
+		return false;
+
+	for (const LevelReport& level : levels)
+		if (!level.isValid())
+			return false;
+	return true;
+}
+
+
+
+namespace
+{
+	LevelIssue makeIssue(LevelIssueSeverity severity, std::string_view code, std::string message,
+		std::optional<std::size_t> board = {}, std::optional<RowIndex> row = {}, std::optional<ColumnIndex> column = {})
+	{
+		return { severity, std::string(code), std::move(message), board, row, column };
+	}
+
+	template <typename _ActionTy>
+	void forEachNeighbor(RowIndex row, ColumnIndex column, ColumnCount columns, _ActionTy&& action)
+	{
+		const auto visit = [&](Int64 r, Int64 c) {
+			if (r < 0 || r >= Int64(utils::level::VisibleRows) || c < 0)
+				return;
+			if (c >= Int64(utils::level::adaptColumnCountIfRowIsOdd(RowIndex(r), columns)))
+				return;
+			action(RowIndex(r), ColumnIndex(c));
+		};
+
+		// Odd rows are shifted half a bubble to the right, so each one sits between columns c and c + 1 of its neighbors. //
+		const Int64 r = Int64(row), c = Int64(column);
+		const Int64 shift = utils::level::isPairRow(row) ? -1 : 0;
+		visit(r, c - 1);
+		visit(r, c + 1);
+		visit(r - 1, c + shift);
+		visit(r - 1, c + shift + 1);
+		visit(r + 1, c + shift);
+		visit(r + 1, c + shift + 1);
+	}
+
+
+	class SolverBoard
+	{
+	public:
+		static constexpr Uint8 Empty = 0;
+		static constexpr Uint8 Blocker = 254;
+		static constexpr Uint8 Multicolor = Uint8(BubbleColorCode::Multicolor);
+
+	private:
+		ColumnCount _columns;
+		std::string _cells;
+
+	public:
+		inline explicit SolverBoard(ColumnCount columns) : _columns(columns), _cells(std::size_t(columns) * utils::level::VisibleRows, char(Empty)) {}
+
+		constexpr ColumnCount columns() const { return _columns; }
+		inline const std::string& key() const { return _cells; }
+
+		inline Uint8 get(RowIndex row, ColumnIndex column) const { return Uint8(_cells[std::size_t(row) * _columns + column]); }
+		inline void set(RowIndex row, ColumnIndex column, Uint8 value) { _cells[std::size_t(row) * _columns + column] = char(value); }
+
+		inline bool isValid(RowIndex row, ColumnIndex column) const
+		{
+			return row < utils::level::VisibleRows && column < utils::level::adaptColumnCountIfRowIsOdd(row, _columns);
+		}
+
+		// Colored bubbles only: blockers never pop, a board is clear once just they are left. //
+		inline std::size_t count() const
+		{
+			std::size_t count = 0;
+			for (char cell : _cells)
+				if (Uint8(cell) != Empty && Uint8(cell) != Blocker)
+					count++;
+			return count;
+		}
+
+		inline bool hasBottomBubble() const
+		{
+			const RowIndex row = utils::level::VisibleRows - 1;
+			for (ColumnIndex c = 0; c < _columns; ++c)
+				if (get(row, c) != Empty)
+					return true;
+			return false;
+		}
+
+		static constexpr bool matches(Uint8 shot, Uint8 cell)
+		{
+			if (shot == Blocker || cell == Blocker || shot == Empty || cell == Empty)
+				return false;
+			return utils::bubble::bubbleColorCodeMatches(BubbleColorCode(shot), BubbleColorCode(cell));
+		}
+
+		inline bool isAttachable(RowIndex row, ColumnIndex column) const
+		{
+			if (!isValid(row, column) || get(row, column) != Empty)
+				return false;
+			if (row == 0)
+				return true;
+
+			bool attached = false;
+			forEachNeighbor(row, column, _columns, [&](RowIndex r, ColumnIndex c) { attached = attached || get(r, c) != Empty; });
+			return attached;
+		}
+
+		inline bool hasMatchingNeighbor(RowIndex row, ColumnIndex column, Uint8 color) const
+		{
+			bool found = false;
+			forEachNeighbor(row, column, _columns, [&](RowIndex r, ColumnIndex c) { found = found || matches(color, get(r, c)); });
+			return found;
+		}
+
+		std::size_t shoot(RowIndex row, ColumnIndex column, Uint8 color)
+		{
+			PROFILE_ZONE("board.resolve");
+			set(row, column, color);
+
+			std::vector<std::pair<RowIndex, ColumnIndex>> group = { { row, column } };
+			std::unordered_set<std::size_t> visited = { std::size_t(row) * _columns + column };
+			for (std::size_t i = 0; i < group.size(); ++i)
+			{
+				forEachNeighbor(group[i].first, group[i].second, _columns, [&](RowIndex r, ColumnIndex c) {
+					if (matches(color, get(r, c)) && visited.insert(std::size_t(r) * _columns + c).second)
+						group.push_back({ r, c });
+				});
+			}
+
+			if (group.size() < 3)
+				return 0;
+
+			for (const auto& cell : group)
+				set(cell.first, cell.second, Empty);
+
+			return group.size() + dropFloating();
+		}
+
+		std::size_t dropFloating()
+		{
+			PROFILE_ZONE("board.dropFloating");
+			std::vector<bool> anchored(_cells.size(), false);
+			std::vector<std::pair<RowIndex, ColumnIndex>> open;
+			for (ColumnIndex c = 0; c < _columns; ++c)
+				if (get(0, c) != Empty)
+					open.push_back({ 0, c }), anchored[c] = true;
+
+			while (!open.empty())
+			{
+				const auto cell = open.back();
+				open.pop_back();
+				forEachNeighbor(cell.first, cell.second, _columns, [&](RowIndex r, ColumnIndex c) {
+					const std::size_t idx = std::size_t(r) * _columns + c;
+					if (!anchored[idx] && get(r, c) != Empty)
+						anchored[idx] = true, open.push_back({ r, c });
+				});
+			}
+
+			std::size_t dropped = 0;
+			for (std::size_t i = 0; i < _cells.size(); ++i)
+				if (!anchored[i] && Uint8(_cells[i]) != Empty)
+					_cells[i] = char(Empty), dropped++;
+			return dropped;
+		}
+
+		std::vector<Uint8> shotColors(AvailableColorsTable enabled) const
+		{
+			std::vector<Uint8> colors;
+			bool multicolor = false;
+			for (BubbleColor color : BubbleColor::all())
+			{
+				bool present = false;
+				for (char cell : _cells)
+				{
+					present = present || Uint8(cell) == Uint8(color.code());
+					multicolor = multicolor || Uint8(cell) == Multicolor;
+				}
+				if (present)
+					colors.push_back(Uint8(color.code()));
+			}
+
+			if (colors.empty() || multicolor)
+			{
+				colors.clear();
+				for (BubbleColor color : BubbleColor::all())
+					if (enabled.isEnabled(color))
+						colors.push_back(Uint8(color.code()));
+			}
+			return colors;
+		}
+	};
+
+
+	class BoundedSolver
+	{
+	private:
+		struct Move
+		{
+			SolverBoard board;
+			std::size_t remaining;
+		};
+
+	private:
+		AvailableColorsTable _colors;
+		Uint32 _maxShots;
+		Uint64 _maxNodes;
+		Uint64 _nodes = 0;
+		bool _exhausted = false;
+		// Shallowest depth each board was reached at, a board seen with more shots left is searched again. //
+		std::unordered_map<std::string, Uint32> _visited;
+
+	public:
+		inline BoundedSolver(AvailableColorsTable colors, Uint32 maxShots, Uint64 maxNodes) :
+			_colors(colors), _maxShots(maxShots), _maxNodes(maxNodes) {}
+
+		constexpr Uint64 nodes() const { return _nodes; }
+		constexpr bool exhausted() const { return _exhausted; }
+
+		std::optional<Uint32> run(const SolverBoard& board) { return search(board, 0); }
+
+	private:
+		std::optional<Uint32> search(const SolverBoard& board, Uint32 depth)
+		{
+			if (board.count() == 0)
+				return depth;
+
+			if (depth >= _maxShots)
+				return {};
+
+			auto [visited, inserted] = _visited.try_emplace(board.key(), depth);
+			if (!inserted)
+			{
+				if (visited->second <= depth)
+					return {};
+				visited->second = depth;
+			}
+
+			std::vector<Move> moves;
+			const std::vector<Uint8> colors = board.shotColors(_colors);
+			for (RowIndex r = 0; r < utils::level::VisibleRows; ++r)
+			{
+				for (ColumnIndex c = 0; c < board.columns(); ++c)
+				{
+					if (!board.isAttachable(r, c))
+						continue;
+
+					for (Uint8 color : colors)
+					{
+						if (_nodes >= _maxNodes)
+						{
+							_exhausted = true;
+							return {};
+						}
+
+						SolverBoard next = board;
+						const std::size_t removed = next.shoot(r, c, color);
+						_nodes++;
+
+						// Shots that do not pop are only worth exploring when they grow an existing group. //
+						if (removed == 0 && !board.hasMatchingNeighbor(r, c, color))
+							continue;
+						if (next.hasBottomBubble())
+							continue;
+
+						const std::size_t remaining = next.count();
+						moves.push_back({ std::move(next), remaining });
+					}
+				}
+			}
+
+			std::sort(moves.begin(), moves.end(), [](const Move& left, const Move& right) { return left.remaining < right.remaining; });
+			for (const Move& move : moves)
+			{
+				auto result = search(move.board, depth + 1);
+				if (result.has_value() || _exhausted)
+					return result;
+			}
+
+			return {};
+		}
+	};
+}
+
+
+
+std::vector<LevelPackReport> LevelValidator::validate(const std::vector<Path>& packPaths) const
+{
+	std::vector<LevelPack> packs(packPaths.size());
+	std::vector<LevelPackReport> reports(packPaths.size());
+
+	struct Task
+	{
+		std::size_t pack;
+		std::size_t level;
+		std::optional<std::size_t> board;
+	};
+
+	std::vector<Task> tasks;
+	for (std::size_t p = 0; p < packPaths.size(); ++p)
+	{
+		LevelPackReport& report = reports[p];
+		report.path = packPaths[p];
+		report.loaded = packs[p].load(packPaths[p]);
+		report.name = packs[p].getName().empty() ? utils::path::getFileName(packPaths[p], false) : packs[p].getName();
+		report.levels.resize(packs[p].getLevelCount());
+
+		for (std::size_t l = 0; l < packs[p].getLevelCount(); ++l)
+		{
+			const LevelProperties& level = packs[p].getLevel(l);
+			report.levels[l].level = l;
+			if (_options.solve)
+				report.levels[l].solver.resize(level.getBubbleBoardCount());
+
+			tasks.push_back({ p, l, {} });
+			for (std::size_t b = 0; b < level.getBubbleBoardCount(); ++b)
+				tasks.push_back({ p, l, b });
+		}
+	}
+
+	// Every task owns its own issues slot, so workers never share mutable state. //
+	std::vector<std::vector<LevelIssue>> taskIssues(tasks.size());
+	std::atomic<std::size_t> next = 0;
+
+	const auto worker = [&]() {
+		for (std::size_t i = next++; i < tasks.size(); i = next++)
+		{
+			const Task& task = tasks[i];
+			const LevelProperties& level = packs[task.pack].getLevel(task.level);
+			if (!task.board.has_value())
+				checkLevel(level, taskIssues[i]);
+			else
+			{
+				checkBoard(level, *task.board, taskIssues[i]);
+				if (_options.solve)
+				{
+					LevelSolverResult& result = reports[task.pack].levels[task.level].solver[*task.board];
+					result = solve(level, *task.board);
+					reportSolverResult(result, taskIssues[i]);
+				}
+			}
+		}
+	};
+
+	unsigned int threads = _options.threads > 0 ? _options.threads : std::max(1u, std::thread::hardware_concurrency());
+	threads = static_cast<unsigned int>(std::min<std::size_t>(threads, std::max<std::size_t>(1, tasks.size())));
+	{
+		std::vector<std::jthread> workers;
+		for (unsigned int i = 1; i < threads; ++i)
+			workers.emplace_back(worker);
+		worker();
+	}
+
+	for (std::size_t i = 0; i < tasks.size(); ++i)
+	{
+		auto& issues = reports[tasks[i].pack].levels[tasks[i].level].issues;
+		issues.insert(issues.end(), std::make_move_iterator(taskIssues[i].begin()), std::make_move_iterator(taskIssues[i].end()));
+	}
+
+	return reports;
+}
+
+JsonValue LevelValidator::toJson(const std::vector<LevelPackReport>& reports)
+{
+	std::size_t levelCount = 0, invalidLevels = 0, errors = 0, warnings = 0;
+
+	JsonArray jpacks;
+	for (const LevelPackReport& pack : reports)
+	{
+		JsonArray jlevels;
+		for (const LevelReport& level : pack.levels)
+		{
+			JsonArray jissues;
+			for (const LevelIssue& issue : level.issues)
+			{
+				JsonValue jissue = {
+					{ "severity", issue.severity == LevelIssueSeverity::Error ? "error" : "warning" },
+					{ "code", issue.code },
+					{ "message", issue.message }
+				};
+				if (issue.board.has_value()) jissue["board"] = *issue.board;
+				if (issue.row.has_value()) jissue["row"] = *issue.row;
+				if (issue.column.has_value()) jissue["column"] = *issue.column;
+				jissues.push_back(std::move(jissue));
+
+				if (issue.severity == LevelIssueSeverity::Error)
+					errors++;
+				else
+					warnings++;
+			}
+
+			JsonArray jsolver;
+			for (const LevelSolverResult& result : level.solver)
+			{
+				jsolver.push_back({
+					{ "board", result.board },
+					{ "status", result.clearable ? "clearable" : result.isConclusive() ? "unclearable" : "unknown" },
+					{ "clearable", result.clearable },
+					{ "exhausted", result.exhausted },
+					{ "sampled", result.sampled },
+					{ "shots", result.shots },
+					{ "nodes", result.nodes }
+				});
+			}
+
+			const bool valid = level.isValid();
+			levelCount++;
+			if (!valid)
+				invalidLevels++;
+
+			jlevels.push_back({
+				{ "level", level.level },
+				{ "valid", valid },
+				{ "issues", std::move(jissues) },
+				{ "solver", std::move(jsolver) }
+			});
+		}
+
+		jpacks.push_back({
+			{ "name", pack.name },
+			{ "path", pack.path.string() },
+			{ "loaded", pack.loaded },
+			{ "valid", pack.isValid() },
+			{ "levels", std::move(jlevels) }
+		});
+	}
+
+	return {
+		{ "packs", std::move(jpacks) },
+		{ "summary", {
+			{ "packs", reports.size() },
+			{ "levels", levelCount },
+			{ "invalid_levels", invalidLevels },
+			{ "errors", errors },
+			{ "warnings", warnings }
+		} }
+	};
+}
+
+
+void LevelValidator::checkLevel(const LevelProperties& level, std::vector<LevelIssue>& issues) const
+{
+	if (level.getBubbleBoardCount() == 0 && level.getInitialFilledRows() == 0)
+		issues.push_back(makeIssue(LevelIssueSeverity::Error, "no-boards", "Level has no bubble boards."));
+
+	bool anyColor = false;
+	for (BubbleColor color : BubbleColor::all())
+		anyColor = anyColor || level.isColorEnabled(color);
+	if (!anyColor)
+		issues.push_back(makeIssue(LevelIssueSeverity::Error, "no-colors", "Level has every bubble color disabled."));
+
+	if (level.getHiddenBubbleContainerType().isFinite() && level.getClearBoardRequiredCount() > level.getBubbleBoardCount())
+	{
+		issues.push_back(makeIssue(LevelIssueSeverity::Error, "unreachable-clear-boards", utils::str::format(
+			"Level requires clearing {} boards but only has {}.", level.getClearBoardRequiredCount(), level.getBubbleBoardCount()
+		)));
+	}
+
+	checkGoals(level, issues);
+}
+
+void LevelValidator::checkBoard(const LevelProperties& level, std::size_t boardIndex, std::vector<LevelIssue>& issues) const
+{
+	const MetaBubbleBoard& board = level.getBubbleBoard(boardIndex);
+	const BoardColumnStyle style = level.getColumnStyle();
+	std::size_t bubbles = 0;
+
+	for (RowIndex r = 0; r < board.getRowsCount(); ++r)
+	{
+		const MetaBubbleBoard::Row& row = board.getRow(r);
+		const ColumnCount validColumns = utils::level::adaptColumnCountIfRowIsOdd(r, style);
+		for (ColumnIndex c = 0; c < ColumnIndex(row.size()); ++c)
+		{
+			const MetaBubble& bubble = row[c];
+			if (!bubble)
+				continue;
+
+			bubbles++;
+			if (c >= validColumns)
+			{
+				issues.push_back(makeIssue(LevelIssueSeverity::Error, "invalid-cell", utils::str::format(
+					"Row {} only has {} columns.", r, validColumns
+				), boardIndex, r, c));
+			}
+
+			if (!BubbleModelManager::instance().contains(bubble.getModelName()))
+			{
+				issues.push_back(makeIssue(LevelIssueSeverity::Error, "unknown-model", utils::str::format(
+					"Unknown bubble model '{}'.", bubble.getModelName()
+				), boardIndex, r, c));
+			}
+
+			if (!bubble.hasRandomColor() && bubble.getColor().isNormalColor() && !level.isColorEnabled(bubble.getColor()))
+			{
+				issues.push_back(makeIssue(LevelIssueSeverity::Error, "disabled-color", utils::str::format(
+					"Bubble uses disabled color {}.", bubble.getColor().name()
+				), boardIndex, r, c));
+			}
+		}
+	}
+
+	if (board.hasDroppedRows())
+	{
+		issues.push_back(makeIssue(LevelIssueSeverity::Error, "too-many-rows", utils::str::format(
+			"Board has {} rows but only {} are allowed, the rest are dropped.", board.getSourceRowsCount(), board.getRowsCount()
+		), boardIndex));
+	}
+
+	if (bubbles == 0)
+		issues.push_back(makeIssue(LevelIssueSeverity::Warning, "empty-board", "Board has no bubbles.", boardIndex));
+}
+
+void LevelValidator::reportSolverResult(const LevelSolverResult& result, std::vector<LevelIssue>& issues) const
+{
+	if (result.clearable)
+		return;
+
+	if (result.isConclusive())
+	{
+		issues.push_back(makeIssue(LevelIssueSeverity::Error, "unclearable", utils::str::format(
+			"Board cannot be cleared in {} shots.", _options.maxShots
+		), result.board));
+	}
+	else if (result.exhausted)
+	{
+		issues.push_back(makeIssue(LevelIssueSeverity::Warning, "solver-exhausted", utils::str::format(
+			"Solver gave up after {} nodes, the board may still be clearable.", result.nodes
+		), result.board));
+	}
+	else
+	{
+		issues.push_back(makeIssue(LevelIssueSeverity::Warning, "solver-sampled", utils::str::format(
+			"Board was not cleared in {} shots with one sample of its random colors.", _options.maxShots
+		), result.board));
+	}
+}
+
+void LevelValidator::checkGoals(const LevelProperties& level, std::vector<LevelIssue>& issues) const
+{
+	const MetaGoals& goals = level.getGoals();
+	const bool finite = level.getHiddenBubbleContainerType().isFinite();
+
+	if (finite && goals.getTimesToClearBoard() > level.getBubbleBoardCount())
+	{
+		issues.push_back(makeIssue(LevelIssueSeverity::Error, "unreachable-goal", utils::str::format(
+			"Goal requires clearing the board {} times but the level only has {} boards.", goals.getTimesToClearBoard(), level.getBubbleBoardCount()
+		)));
+	}
+
+	for (const auto& [bubble, count] : goals.getAllBubbleGoals())
+	{
+		const std::string& model = bubble.getModelName();
+		if (!BubbleModelManager::instance().contains(model))
+		{
+			issues.push_back(makeIssue(LevelIssueSeverity::Error, "unknown-model", utils::str::format(
+				"Goal references unknown bubble model '{}'.", model
+			)));
+			continue;
+		}
+
+		Uint64 onBoards = 0;
+		for (std::size_t b = 0; b < level.getBubbleBoardCount(); ++b)
+		{
+			const MetaBubbleBoard& board = level.getBubbleBoard(b);
+			for (RowIndex r = 0; r < board.getRowsCount(); ++r)
+			{
+				const MetaBubbleBoard::Row& row = board.getRow(r);
+				const ColumnCount validColumns = std::min(ColumnCount(row.size()), utils::level::adaptColumnCountIfRowIsOdd(r, level.getColumnStyle()));
+				for (ColumnIndex c = 0; c < validColumns; ++c)
+				{
+					if (row[c].getModelName() != model)
+						continue;
+					if (bubble.hasRandomColor() || row[c].hasRandomColor() || row[c].getColor() == bubble.getColor())
+						onBoards++;
+				}
+			}
+		}
+
+		const bool colorAvailable = bubble.hasRandomColor() || !bubble.getColor().isNormalColor() || level.isColorEnabled(bubble.getColor());
+		const bool generated =
+			level.getArrowModelSelectorScores().getModelScore(model) > 0 ||
+			(level.isBubbleGenerationEnabled() && level.getBoardModelSelector().getModelScore(model) > 0);
+
+		if ((!generated || !colorAvailable) && onBoards == 0)
+		{
+			issues.push_back(makeIssue(LevelIssueSeverity::Error, "unreachable-goal", utils::str::format(
+				"Goal bubble '{}' ({}) never appears on boards and is never generated.", model, bubble.hasRandomColor() ? "any color" : bubble.getColor().name()
+			)));
+		}
+		else if (!generated && finite && onBoards < count)
+		{
+			issues.push_back(makeIssue(LevelIssueSeverity::Error, "unreachable-goal", utils::str::format(
+				"Goal requires {} '{}' bubbles but boards only contain {}.", count, model, onBoards
+			)));
+		}
+	}
+}
+
+LevelSolverResult LevelValidator::solve(const LevelProperties& level, std::size_t boardIndex) const
+{
+	PROFILE_ZONE("LevelValidator::solve");
+	LevelSolverResult result;
+	result.board = boardIndex;
+
+	const MetaBubbleBoard& meta = level.getBubbleBoard(boardIndex);
+	const ColumnCount columns = utils::level::columnStyleToColumns(level.getColumnStyle());
+
+	std::vector<BubbleColor> enabled;
+	for (BubbleColor color : BubbleColor::all())
+		if (level.isColorEnabled(color))
+			enabled.push_back(color);
+
+	// Random colored cells are resolved with the level seed, so the proof only covers that sample. //
+	RNG rand = RNG(level.isRandomSeed() ? RNG::SeedType(1) : level.getSeed());
+
+	SolverBoard board(columns);
+	for (RowIndex r = 0; r < meta.getRowsCount(); ++r)
+	{
+		const MetaBubbleBoard::Row& row = meta.getRow(r);
+		for (ColumnIndex c = 0; c < ColumnIndex(row.size()); ++c)
+		{
+			const MetaBubble& bubble = row[c];
+			if (!bubble || !board.isValid(r, c))
+				continue;
+
+			if (bubble.hasRandomColor())
+			{
+				result.sampled = true;
+				board.set(r, c, enabled.empty() ? SolverBoard::Blocker : Uint8(rand.randomEntry(enabled).code()));
+			}
+			else if (bubble.getColor().isColorless())
+				board.set(r, c, SolverBoard::Blocker);
+			else
+				board.set(r, c, Uint8(bubble.getColor().code()));
+		}
+	}
+	board.dropFloating();
+
+	BoundedSolver solver(level.getEnabledColors(), _options.maxShots, _options.maxNodes);
+	auto shots = solver.run(board);
+
+	result.clearable = shots.has_value();
+	result.exhausted = solver.exhausted();
+	result.shots = shots.value_or(0);
+	result.nodes = solver.nodes();
+	return result;
+}
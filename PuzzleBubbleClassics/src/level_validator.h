@@ -0,0 +1,103 @@
+#pragma once
+
+#include "level_pack.h"
+
+#include <optional>
+
+
+enum class LevelIssueSeverity
+{
+	Warning,
+	Error
+};
+
+
+struct LevelIssue
+{
+	LevelIssueSeverity severity = LevelIssueSeverity::Error;
+	std::string code;
+	std::string message;
+	std::optional<std::size_t> board;
+	std::optional<RowIndex> row;
+	std::optional<ColumnIndex> column;
+};
+
+
+struct LevelSolverResult
+{
+	std::size_t board = 0;
+	bool clearable = false;
+	bool exhausted = false;
+	bool sampled = false;
+	Uint32 shots = 0;
+	Uint64 nodes = 0;
+
+	// A failed search only proves the board unclearable when it was complete and had no random colors. //
+	constexpr bool isConclusive() const { return clearable || (!exhausted && !sampled); }
+};
+
+
+struct LevelReport
+{
+	std::size_t level = 0;
+	std::vector<LevelIssue> issues;
+	std::vector<LevelSolverResult> solver;
+
+	bool isValid() const;
+};
+
+
+struct LevelPackReport
+{
+	std::string name;
+	Path path;
+	bool loaded = false;
+	std::vector<LevelReport> levels;
+
+	bool isValid() const;
+};
+
+
+
+class LevelValidator
+{
+public:
+	struct Options
+	{
+		bool solve = false;
+		Uint32 maxShots = 48;
+		Uint64 maxNodes = 250000;
+		unsigned int threads = 0;
+	};
+
+private:
+	Options _options;
+
+public:
+	LevelValidator() = default;
+	LevelValidator(const LevelValidator&) = default;
+	LevelValidator(LevelValidator&&) noexcept = default;
+	~LevelValidator() = default;
+
+	LevelValidator& operator= (const LevelValidator&) = default;
+	LevelValidator& operator= (LevelValidator&&) noexcept = default;
+
+public:
+	inline explicit LevelValidator(const Options& options) : _options(options) {}
+
+	constexpr const Options& getOptions() const { return _options; }
+	constexpr void setOptions(const Options& options) { _options = options; }
+
+public:
+	std::vector<LevelPackReport> validate(const std::vector<Path>& packPaths) const;
+
+	static JsonValue toJson(const std::vector<LevelPackReport>& reports);
+
+private:
+	void checkLevel(const LevelProperties& level, std::vector<LevelIssue>& issues) const;
+	void checkBoard(const LevelProperties& level, std::size_t boardIndex, std::vector<LevelIssue>& issues) const;
+	void checkGoals(const LevelProperties& level, std::vector<LevelIssue>& issues) const;
+	void reportSolverResult(const LevelSolverResult& result, std::vector<LevelIssue>& issues) const;
+
+	LevelSolverResult solve(const LevelProperties& level, std::size_t boardIndex) const;
+};
@@ -0,0 +1,77 @@
+#include "loading_activity.h"
+
+#include "resource_loader.h"
+#include "font.h"
+#include "text_renderer.h"
+
+
+void LoadingActivity::init()
+{
+	const sf::Vector2f position = {
+		(GameController::CanvasWidth - BarWidth) / 2.f,
+		(GameController::CanvasHeight - BarHeight) / 2.f
+	};
+
+	_frame.setSize({ BarWidth, BarHeight });
+	_frame.setPosition(position);
+	_frame.setFillColor(sf::Color::Transparent);
+	_frame.setOutlineColor(sf::Color::White);
+	_frame.setOutlineThickness(2.f);
+
+	_bar.setSize({ 0.f, BarHeight });
+	_bar.setPosition(position);
+	_bar.setFillColor({ 16, 220, 16 });
+
+	_text.setCharacterSize(24);
+	_text.setFillColor(sf::Color::White);
+	_text.setPosition(position.x, position.y + BarHeight + 12.f);
+
+	updateProgress();
+}
+
+void LoadingActivity::update(const sf::Time& elapsedTime)
+{
+	ResourceLoader& loader = ResourceLoader::instance();
+	const bool progressed = loader.poll(_budget);
+	_changed = updateProgress() || progressed;
+
+	if (loader.isIdle())
+	{
+		if (loader.getFailedCount() > 0)
+			logger::warn("Loading: {} of {} resources failed to load.", loader.getFailedCount(), loader.getSubmittedCount());
+
+		// Fonts are loaded now, bake the sizes the game texts use before the first of them shows up. Glyph pages are textures, runs without graphics skip them. //
+		if (GameController::instance().hasGraphics())
+			BitmapFontManager::instance().bakeDefaults();
+
+		dispose();
+		if (_onFinished)
+			_onFinished();
+	}
+}
+
+void LoadingActivity::render(sf::RenderTarget& canvas, sf::RenderStates rs)
+{
+	canvas.draw(_bar, rs);
+	canvas.draw(_frame, rs);
+	if (_font != nullptr)
+		canvas.draw(_text, rs);
+}
+
+bool LoadingActivity::updateProgress()
+{
+	const float progress = ResourceLoader::instance().getProgress();
+	_bar.setSize({ BarWidth * progress, BarHeight });
+
+	// The font itself is one of the loaded resources, so the text shows up as soon as it is available. //
+	bool fontShown = false;
+	if (_font == nullptr)
+	{
+		_font = FontManager::instance().get("arial");
+		if (_font != nullptr)
+			_text.setFont(*_font), fontShown = true;
+	}
+
+	_text.setString(std::to_string(static_cast<int>(progress * 100.f)) + "%");
+	return fontShown;
+}
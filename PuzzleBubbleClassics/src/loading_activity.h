@@ -0,0 +1,52 @@
+#pragma once
+
+#include "game_controller.h"
+
+#include <functional>
+
+
+class LoadingActivity : public GameActivity
+{
+public:
+	using Continuation = std::function<void()>;
+
+	static constexpr float BarWidth = 640.f;
+	static constexpr float BarHeight = 24.f;
+
+private:
+	Continuation _onFinished;
+	sf::Time _budget = sf::milliseconds(8);
+
+	sf::RectangleShape _frame;
+	sf::RectangleShape _bar;
+	sf::Text _text;
+	std::shared_ptr<sf::Font> _font;
+	bool _changed = true;
+
+public:
+	LoadingActivity() = default;
+	LoadingActivity(const LoadingActivity&) = delete;
+	LoadingActivity(LoadingActivity&&) noexcept = default;
+	~LoadingActivity() = default;
+
+	LoadingActivity& operator= (const LoadingActivity&) = delete;
+	LoadingActivity& operator= (LoadingActivity&&) noexcept = delete;
+
+public:
+	inline explicit LoadingActivity(Continuation onFinished) : _onFinished(std::move(onFinished)) {}
+
+	inline sf::Time getFrameBudget() const { return _budget; }
+	inline void setFrameBudget(sf::Time budget) { _budget = budget; }
+
+public:
+	void init() override;
+	void update(const sf::Time& elapsedTime) override;
+	void render(sf::RenderTarget& canvas, sf::RenderStates rs) override;
+
+	// While workers decode and nothing is ready to upload, the bar and the text stay the same. //
+	inline bool isIdle() const override { return !_changed; }
+
+private:
+	// Returns whether the text font showed up. //
+	bool updateProgress();
+};
@@ -4,6 +4,7 @@
 
 #include "utils/manager.h"
 #include "utils/path.h"
+#include "utils/profiler.h"
 
 
 class LuaTemplate
@@ -60,6 +61,7 @@ protected:
 	template <typename... _ArgsTys>
 	inline void vcall(std::string_view name, _ArgsTys&&... args)
 	{
+		PROFILE_ZONE(name);
 		auto fn = findLuaObject(name);
 		if (fn != nullptr)
 		{
@@ -8,25 +8,38 @@
 #include "scenario_utils.h"
 #include "utils/debug_grid.h"
 #include "utils/angle.h"
+#include "level_validator.h"
+#include "loading_activity.h"
+#include "resource_loader.h"
+#include "startup.h"
+#include "particle_system.h"
+#include "text_renderer.h"
+#include "jobs.h"
+#include "utils/profiler.h"
+
+#include <bit>
 
 
 class TestActivity : public GameActivity
 {
+public:
+	static constexpr sf::Keyboard::Key PauseKey = sf::Keyboard::P;
+
 private:
-	sf::Text _text;
-	std::shared_ptr<sf::Font> _font;
+	BitmapText _text;
 	sf::Time _remaining;
 	RNG _rng;
+	ParticleSystem _sparks;
+	bool _paused = false;
 
 	DebugGrid _dbgrid;
 
 public:
 	void init() override
 	{
-		_font = FontManager::instance().get("bubble2");
-		_text.setFont(*_font);
-		_text.setCharacterSize(50);
-		_text.setOutlineThickness(1);
+		// Headless runs without graphics keep the text fontless, its string and rotation still go into the hash. //
+		if (GameController::instance().hasGraphics())
+			_text.setFont(BitmapFontManager::instance().bake("bubble2", 50, 1));
 		_text.setOutlineColor({ 0, 0, 255 });
 		_text.setFillColor({ 16, 220, 16 });
 		_text.setPosition(500, 200);
@@ -37,11 +50,23 @@ public:
 	{
 		auto bounds = _text.getLocalBounds();
 		canvas.draw(_text, rs);
+		_sparks.render(canvas, rs);
 		//_dbgrid.render(canvas, rs);
 	}
 
+	void dispatchEvent(const sf::Event& event) override
+	{
+		if (event.type == sf::Event::KeyPressed && event.key.code == PauseKey)
+			_paused = !_paused;
+	}
+
 	void update(const sf::Time& elapsedTime) override
 	{
+		// Paused, the sparks already flying finish and then the frame stays as it is. //
+		_sparks.update(elapsedTime);
+		if (_paused)
+			return;
+
 		_text.rotate(10.f * elapsedTime.asSeconds());
 		if (_remaining <= sf::Time::Zero)
 		{
@@ -54,23 +79,257 @@ public:
 			});
 
 			_remaining = sf::milliseconds(1000.f + _rng(0, 2000));
+			_sparks.emit("bubble.pop", _text.getPosition());
 		}
 		else _remaining -= elapsedTime;
 	}
+
+	inline bool isIdle() const override { return _paused && _sparks.empty(); }
+
+	// Everything else starts the same on every run. //
+	inline void saveReplayState(Replay& replay) const { replay.setStream("test", _rng.getState()); }
+	inline void restoreReplayState(const Replay& replay) { replay.restoreStream("test", _rng); }
+
+	// Only its own text, sparks and generator change in update(), the glyph-run cache it reads is locked. //
+	bool isParallelUpdateSafe() const override { return true; }
+
+	// The sparks only draw, they do not take part in the hash. //
+	Uint64 getStateHash() const override
+	{
+		static constexpr Uint64 Prime = 0x100000001b3;
+
+		Uint64 hash = _rng.getState();
+		hash = (hash ^ Uint64(_paused)) * Prime;
+		hash = (hash ^ Uint64(_remaining.asMicroseconds())) * Prime;
+		hash = (hash ^ std::bit_cast<Uint32>(_text.getRotation())) * Prime;
+		return (hash ^ std::hash<std::string>{}(_text.getString())) * Prime;
+	}
 };
 
 
+static int validateLevels(int argc, char** argv)
+{
+	LevelValidator::Options options;
+	std::vector<Path> packs;
+	std::optional<Path> reportPath;
+
+	for (int i = 0; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg == "--solve")
+			options.solve = true;
+		else if (arg == "--report" && i + 1 < argc)
+			reportPath = Path(argv[++i]);
+		else if (arg == "--threads" && i + 1 < argc)
+			options.threads = unsigned(std::stoul(argv[++i]));
+		else if (arg == "--max-shots" && i + 1 < argc)
+			options.maxShots = Uint32(std::stoul(argv[++i]));
+		else if (arg == "--max-nodes" && i + 1 < argc)
+			options.maxNodes = Uint64(std::stoull(argv[++i]));
+		else if (utils::path::isDirectory(Path(arg)))
+			utils::path::scanDirectoryFiles(Path(arg), ".json", [&packs](const Path& path) { packs.push_back(path); });
+		else
+			packs.push_back(Path(arg));
+	}
+
+	if (packs.empty())
+	{
+		logger::error("Level validator: Expected at least one level pack.");
+		return 2;
+	}
+
+	DataPool::instance().load();
+	ResourceLoader::instance().waitAll();
+	BubbleModelManager::instance().loadAllModels();
+
+	const auto reports = LevelValidator(options).validate(packs);
+	const JsonValue json = LevelValidator::toJson(reports);
+
+	if (reportPath.has_value())
+		json::write(reportPath->string(), json);
+	else
+		std::cout << json.dump(4) << std::endl;
+
+	for (const auto& report : reports)
+		if (!report.isValid())
+			return 1;
+	return 0;
+}
+
+
+static std::optional<HeadlessOptions> readHeadlessOptions(int argc, char** argv)
+{
+	bool headless = false;
+	HeadlessOptions options;
+	std::optional<Path> inputPath;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg == "--headless")
+			headless = true;
+		else if (arg == "--speed" && i + 1 < argc)
+			options.speed = std::stof(argv[++i]);
+		else if (arg == "--render-every" && i + 1 < argc)
+			options.renderEvery = unsigned(std::stoul(argv[++i]));
+		else if (arg == "--duration" && i + 1 < argc)
+			options.duration = sf::seconds(std::stof(argv[++i]));
+		else if (arg == "--input" && i + 1 < argc)
+			inputPath = Path(argv[++i]);
+		else if (arg == "--state-hashes" && i + 2 < argc)
+		{
+			options.stateHashEvery = unsigned(std::stoul(argv[++i]));
+			options.stateHashLog = Path(argv[++i]);
+		}
+		else if (arg == "--serial")
+			GameController::instance().setParallelUpdateEnabled(false);
+		else if (arg == "--jobs" && i + 1 < argc)
+			JobSystem::instance().setWorkerCount(unsigned(std::stoul(argv[++i])));
+	}
+
+	if (!headless)
+		return {};
+
+	if (inputPath.has_value())
+		options.input.load(*inputPath, GameController::instance().getStepTime());
+	return options;
+}
+
+
+// "--budget <textures|fonts|bitmap-fonts> <MiB>", zero keeps every entry of the manager resident. //
+static bool setResourceBudget(std::string_view manager, std::size_t mebibytes)
+{
+	const std::size_t bytes = mebibytes * 1024 * 1024;
+	if (manager == "textures")
+		TextureManager::instance().setBudget(bytes);
+	else if (manager == "fonts")
+		FontManager::instance().setBudget(bytes);
+	else if (manager == "bitmap-fonts")
+		BitmapFontManager::instance().setBudget(bytes);
+	else
+	{
+		logger::error("Unknown resource budget '{}', expected textures, fonts or bitmap-fonts.", manager);
+		return false;
+	}
+	return true;
+}
+
+
 int main(int argc, char** argv)
 {
+	if (argc > 1 && std::string_view(argv[1]) == "--validate-levels")
+		return validateLevels(argc - 2, argv + 2);
+
+	if (argc > 1 && std::string_view(argv[1]) == "--pack-archive")
+	{
+		if (argc < 4)
+		{
+			logger::error("Archive pack: Expected <directory> <output> arguments.");
+			return 2;
+		}
+		return resources::Archive::pack(Path(argv[2]), Path(argv[3])) ? 0 : 1;
+	}
+
+	std::optional<Path> startupReportPath;
+	std::optional<Path> tracePath;
+	std::optional<Path> recordPath;
+	std::optional<Path> replayPath;
+	std::optional<Uint64> seekTick;
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (std::string_view(argv[i]) == "--startup-report")
+			startupReportPath = Path(argv[i + 1]);
+		else if (std::string_view(argv[i]) == "--profile")
+			tracePath = Path(argv[i + 1]);
+		else if (std::string_view(argv[i]) == "--record")
+			recordPath = Path(argv[i + 1]);
+		else if (std::string_view(argv[i]) == "--replay")
+			replayPath = Path(argv[i + 1]);
+		else if (std::string_view(argv[i]) == "--seek")
+			seekTick = Uint64(std::stoull(argv[i + 1]));
+		else if (std::string_view(argv[i]) == "--budget" && i + 2 < argc)
+			setResourceBudget(argv[i + 1], std::size_t(std::stoull(argv[i + 2])));
+	}
+
+	if (auto headless = readHeadlessOptions(argc, argv); headless.has_value())
+		GameController::instance().setHeadless(std::move(*headless));
+
 	auto angle = 180_deg;
 
-	DataPool::instance().load();
+	// Fonts decode on the loader workers while Lua models compile on the main thread, fonts.wait reports what is left of the decode. //
+	StartupGraph startup;
+	startup
+		.add("packages", {}, []() { return DataPool::instance().mount(); })
+		.add("index", { "packages" }, []() { DataPool::instance().rescan(); return true; })
+		.add("window", {}, StartupAffinity::Main, []() { GameController::instance().open(); return true; })
+		.add("fonts", { "index" }, StartupAffinity::Main, []() { DataPool::instance().loadPackagesData(); return true; })
+		.add("models", { "index" }, StartupAffinity::Main, []() { BubbleModelManager::instance().loadAllModels(); return true; })
+		.add("fonts.wait", { "fonts", "models" }, StartupAffinity::Main, []() { ResourceLoader::instance().waitAll(); return true; })
+		.add("particles", { "atlas.upload" }, StartupAffinity::Main, []() { return ParticlePresetManager::instance().loadAll(); });
 
-	BubbleModelManager::instance().loadAllModels();
+	// Without a GL context the atlas is neither packed nor uploaded, the nodes stay so the report keeps its shape. //
+	if (GameController::instance().hasGraphics())
+	{
+		startup
+			.add("atlas.pack", { "index" }, []() { return TextureManager::instance().packAtlases(); })
+			.add("atlas.upload", { "atlas.pack", "window" }, StartupAffinity::Main, []() { return TextureManager::instance().uploadAtlases(); });
+	}
+	else
+	{
+		startup
+			.add("atlas.pack", { "index" }, []() { return true; })
+			.add("atlas.upload", { "atlas.pack" }, []() { return true; });
+	}
+
+	const bool started = startup.run();
+	startup.printReport(std::cout);
+	if (startupReportPath.has_value())
+		startup.writeReport(*startupReportPath);
+
+	if (!started)
+		return 1;
+
+	std::optional<Replay> replay;
+	if (replayPath.has_value())
+	{
+		replay.emplace();
+		if (!replay->load(*replayPath))
+			return 1;
+	}
+
+	const auto createTest = [&replay]() {
+		auto test = GameController::instance().createActivity<TestActivity>();
+		if (replay.has_value())
+			test->restoreReplayState(*replay);
+		return test;
+	};
+
+	// Replays begin with the test activity, so the loading time does not shift their ticks. //
+	GameController::instance().createActivity<LoadingActivity>([&]() {
+		// The replay clock restarts first, the timers the test activity arms have to outlive it. //
+		GameController& controller = GameController::instance();
+		if (replay.has_value())
+		{
+			controller.startPlayback(*replay, [&createTest]() { createTest(); });
+			if (seekTick.has_value())
+				controller.seek(*seekTick);
+		}
+		if (recordPath.has_value())
+			controller.startRecording({});
+
+		auto test = createTest();
+		if (recordPath.has_value())
+			test->saveReplayState(controller.getRecording());
+	});
 
-	auto a = GameController::instance().createActivity<TestActivity>();
 	GameController::instance().start();
 
+	if (recordPath.has_value() && GameController::instance().isRecording())
+		GameController::instance().stopRecording().save(*recordPath);
+
+	if (tracePath.has_value())
+		profiler::writeChromeTrace(*tracePath);
+
 	HiddenBubbleContainerType type;
 	type.discrete = true;
 
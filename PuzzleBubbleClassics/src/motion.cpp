@@ -1,13 +1,43 @@
 #include "motion.h"
 
+#include "game_controller.h"
+
 
 void DefaultMotionObject::update(const sf::Time& elapsedTime)
 {
+	_previousPosition = getPosition();
+	_previousRotation = getRotation();
+	_hasPreviousState = true;
+
 	const float delta = elapsedTime.asSeconds();
 	setPosition(getPosition() + (_speed * delta));
 	_speed += _acceleration * delta;
 	setRotation(getRotation() + (_rotationSpeed * delta));
 	_rotationSpeed += _rotationAcceleration * delta;
+
+	_steppedPosition = getPosition();
+	_steppedRotation = getRotation();
+}
+
+sf::Transform DefaultMotionObject::getInterpolatedTransform(float alpha) const
+{
+	if (!_hasPreviousState || alpha >= 1.f)
+		return getTransform();
+
+	// Moved by setPosition() or setRotation() since the step, there is nothing to blend from. //
+	if (getPosition() != _steppedPosition || getRotation() != _steppedRotation)
+		return getTransform();
+
+	float rotationDelta = getRotation() - _previousRotation;
+	if (rotationDelta > 180.f)
+		rotationDelta -= 360.f;
+	else if (rotationDelta < -180.f)
+		rotationDelta += 360.f;
+
+	sf::Transformable state = *this;
+	state.setPosition(_previousPosition + (getPosition() - _previousPosition) * alpha);
+	state.setRotation(_previousRotation + rotationDelta * alpha);
+	return state.getTransform();
 }
 
 
@@ -27,16 +57,15 @@ void InternalSpriteMotionObject::render(sf::RenderTarget& canvas, sf::RenderStat
 	if (_sprite == nullptr)
 		return;
 
-	rs.transform *= getTransform();
+	rs.transform *= getInterpolatedTransform(GameController::instance().getInterpolationAlpha());
 	canvas.draw(_sprite, rs);
 }
 
 
 void InternalSpriteMotionObject::update(const sf::Time& elapsedTime)
 {
+	// Sprite animations follow the AnimationClock and are resolved when drawn. //
 	DefaultMotionObject::update(elapsedTime);
-	if (_sprite != nullptr)
-		_sprite.update(elapsedTime);
 }
 
 
@@ -12,6 +12,16 @@ private:
 	float _rotationSpeed = 0;
 	float _rotationAcceleration = 0;
 
+	/*
+		State before and after the last fixed step, rendering blends between them. When the object no
+		longer is where the step left it, it was placed outside update() and is drawn where it is.
+	*/
+	sf::Vector2f _previousPosition;
+	float _previousRotation = 0;
+	sf::Vector2f _steppedPosition;
+	float _steppedRotation = 0;
+	bool _hasPreviousState = false;
+
 public:
 	DefaultMotionObject() = default;
 	DefaultMotionObject(const DefaultMotionObject&) = default;
@@ -34,6 +44,11 @@ public:
 	constexpr float getRotationAcceleration() const { return _rotationAcceleration; }
 	constexpr void setRotationAcceleration(float rotationAcceleration) { _rotationAcceleration = rotationAcceleration; }
 
+	// Teleports are detected on their own, this also drops the blend when the object is moved back to where the step left it. //
+	constexpr void resetInterpolation() { _hasPreviousState = false; }
+
+	sf::Transform getInterpolatedTransform(float alpha) const;
+
 public:
 	void update(const sf::Time& elapsedTime) override;
 };
@@ -1,5 +1,7 @@
 #include "particle.h"
 
+#include "game_controller.h"
+
 
 void Particle::update(const sf::Time& elapsedTime)
 {
@@ -17,7 +19,7 @@ void SpriteParticle::render(sf::RenderTarget& canvas, sf::RenderStates rs)
 	if (isDead())
 		return;
 
-	rs.transform *= getTransform();
+	rs.transform *= getInterpolatedTransform(GameController::instance().getInterpolationAlpha());
 	rs.blendMode = sf::BlendAlpha;
 	SpriteObject::render(canvas, rs);
 }
@@ -0,0 +1,409 @@
+#include "particle_system.h"
+
+#include "game_controller.h"
+#include "sprite.h"
+
+#include "utils/json.h"
+#include "utils/logger.h"
+#include "utils/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#	define PBC_PARTICLES_SSE 1
+#	include <emmintrin.h>
+#else
+#	define PBC_PARTICLES_SSE 0
+#endif
+
+
+ParticlePresetManager ParticlePresetManager::Instance;
+
+static ParticleRange readRange(const JsonValue& json, std::string_view field, ParticleRange fallback)
+{
+	if (!json.contains(field))
+		return fallback;
+
+	const JsonValue& value = json.at(field);
+	if (value.is_number())
+		return { value.get<float>(), value.get<float>() };
+	if (value.is_array() && value.size() == 2)
+		return { value.at(0).get<float>(), value.at(1).get<float>() };
+	return fallback;
+}
+
+static sf::Vector2f readVector(const JsonValue& json, std::string_view field, const sf::Vector2f& fallback)
+{
+	if (!json.contains(field))
+		return fallback;
+
+	const JsonValue& value = json.at(field);
+	if (value.is_array() && value.size() == 2)
+		return { value.at(0).get<float>(), value.at(1).get<float>() };
+	return fallback;
+}
+
+static sf::BlendMode readBlendMode(const JsonValue& json)
+{
+	const std::string name = json.value("blend", "alpha");
+	if (name == "add")
+		return sf::BlendAdd;
+	if (name == "multiply")
+		return sf::BlendMultiply;
+	return sf::BlendAlpha;
+}
+
+static TextureRegion readTexture(const JsonValue& json)
+{
+	// Presets still simulate without graphics, only their texture is left out. //
+	const std::string file = json.value("texture", "");
+	if (file.empty() || !GameController::instance().hasGraphics())
+		return {};
+
+	TextureManager& textures = TextureManager::instance();
+	const std::string tag = "particles:" + file;
+	TextureRegion region = textures.getRegion(tag);
+	if (!region.isValid())
+	{
+		if (!textures.load(Path(file), tag))
+		{
+			logger::error("Particles: Cannot load texture '{}'.", file);
+			return {};
+		}
+		region = textures.getRegion(tag);
+	}
+
+	if (json.contains("rect") && json.at("rect").is_array() && json.at("rect").size() == 4)
+	{
+		const JsonValue& rect = json.at("rect");
+		region.rect = {
+			region.rect.left + rect.at(0).get<int>(),
+			region.rect.top + rect.at(1).get<int>(),
+			rect.at(2).get<int>(),
+			rect.at(3).get<int>()
+		};
+	}
+	return region;
+}
+
+static ParticlePreset readPreset(const JsonValue& json)
+{
+	ParticlePreset preset;
+	preset.region = readTexture(json);
+	preset.frames = std::max(Uint32(1), json.value("frames", Uint32(1)));
+	preset.fps = json.value("fps", 0.f);
+	preset.loop = json.value("loop", true);
+
+	preset.count = readRange(json, "count", preset.count);
+	preset.lifetime = readRange(json, "lifetime", preset.lifetime);
+	preset.speed = readRange(json, "speed", preset.speed);
+	preset.angle = readRange(json, "angle", preset.angle);
+	preset.alpha = readRange(json, "alpha", preset.alpha);
+	preset.alphaSpeed = readRange(json, "alphaSpeed", preset.alphaSpeed);
+	preset.size = readRange(json, "size", preset.size);
+	preset.acceleration = readVector(json, "acceleration", preset.acceleration);
+
+	if (json.contains("color") && json.at("color").is_array() && json.at("color").size() >= 3)
+	{
+		const JsonValue& color = json.at("color");
+		preset.color = {
+			color.at(0).get<Uint8>(),
+			color.at(1).get<Uint8>(),
+			color.at(2).get<Uint8>(),
+			color.size() > 3 ? color.at(3).get<Uint8>() : Uint8(255)
+		};
+	}
+
+	preset.blendMode = readBlendMode(json);
+	return preset;
+}
+
+bool ParticlePresetManager::load(const ResourceLocation& location)
+{
+	PROFILE_ZONE("ParticlePresetManager::load");
+
+	JsonValue json;
+	try
+	{
+		if (location.isArchived())
+		{
+			const auto data = location.read();
+			if (!data.has_value())
+				return false;
+			json = json::parse({ reinterpret_cast<const char*>(data->data()), data->size() });
+		}
+		else json = json::read(location.path().string());
+
+		if (!json.is_object())
+		{
+			logger::error("Particles: '{}' must hold an object of presets.", location.path().string());
+			return false;
+		}
+
+		for (const auto& [name, entry] : json.items())
+		{
+			if (entry.is_object())
+				insert(name, std::make_shared<ParticlePreset>(readPreset(entry)));
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		logger::error("Particles: '{}': {}", location.path().string(), ex.what());
+		return false;
+	}
+
+	return true;
+}
+
+bool ParticlePresetManager::loadAll()
+{
+	// Lower priority packages first, so presets of higher ones replace them. //
+	std::vector<std::pair<std::size_t, ResourceLocation>> files;
+	DataPool::instance().forEachIndexedFile(ResourceDirectoryType::Particles, [&files](const ResourceLocation& location, std::size_t priority) {
+		if (utils::path::hasExtension(location.path(), ".json"))
+			files.push_back({ priority, location });
+	});
+
+	std::sort(files.begin(), files.end(), [](const auto& left, const auto& right) {
+		return left.first != right.first ? left.first > right.first : left.second.path() < right.second.path();
+	});
+
+	bool result = true;
+	for (const auto& [priority, location] : files)
+		if (!load(location))
+			result = false;
+	return result;
+}
+
+
+
+
+void ParticleSystem::reserve(std::size_t count)
+{
+	// Arrays are padded to whole lanes, the tail lanes are integrated but never drawn. //
+	const std::size_t padded = (count + Lanes - 1) / Lanes * Lanes;
+	if (padded <= _positionX.size())
+		return;
+
+	const std::size_t size = std::max(padded, _positionX.size() * 2);
+	for (auto* array : { &_positionX, &_positionY, &_previousX, &_previousY, &_velocityX, &_velocityY, &_accelerationX,
+		&_accelerationY, &_alpha, &_alphaSpeed, &_lifetime, &_frame, &_frameSpeed, &_size })
+		array->resize(size, 0.f);
+	_preset.resize(size, 0);
+}
+
+Uint16 ParticleSystem::presetIndex(const std::shared_ptr<const ParticlePreset>& preset)
+{
+	auto it = std::find(_presets.begin(), _presets.end(), preset);
+	if (it != _presets.end())
+		return Uint16(it - _presets.begin());
+
+	if (_count == 0)
+		_presets.clear();
+	_presets.push_back(preset);
+	return Uint16(_presets.size() - 1);
+}
+
+std::size_t ParticleSystem::emit(const std::shared_ptr<const ParticlePreset>& preset, const sf::Vector2f& position, std::size_t count)
+{
+	if (preset == nullptr)
+		return 0;
+
+	if (count == 0)
+		count = std::size_t(std::max(0.f, std::round(preset->count(_rand))));
+	count = std::min(count, _maxParticles - std::min(_maxParticles, _count));
+	if (count == 0)
+		return 0;
+
+	reserve(_count + count);
+	const Uint16 index = presetIndex(preset);
+	const std::size_t end = _count + count;
+	for (std::size_t i = _count; i < end; ++i)
+	{
+		const float angle = preset->angle(_rand) * std::numbers::pi_v<float> / 180.f;
+		const float speed = preset->speed(_rand);
+
+		_positionX[i] = _previousX[i] = position.x;
+		_positionY[i] = _previousY[i] = position.y;
+		_velocityX[i] = std::cos(angle) * speed;
+		_velocityY[i] = std::sin(angle) * speed;
+		_accelerationX[i] = preset->acceleration.x;
+		_accelerationY[i] = preset->acceleration.y;
+		_alpha[i] = std::clamp(preset->alpha(_rand), 0.f, 1.f);
+		_alphaSpeed[i] = preset->alphaSpeed(_rand);
+		_lifetime[i] = preset->lifetime(_rand);
+		_frame[i] = 0;
+		_frameSpeed[i] = preset->fps;
+		_size[i] = preset->size(_rand);
+		_preset[i] = index;
+	}
+
+	_count = end;
+	return count;
+}
+
+std::size_t ParticleSystem::emit(std::string_view presetName, const sf::Vector2f& position, std::size_t count)
+{
+	auto preset = ParticlePresetManager::instance().get(presetName);
+	if (preset == nullptr)
+	{
+		logger::warn("Particles: Unknown preset '{}'.", presetName);
+		return 0;
+	}
+	return emit(preset, position, count);
+}
+
+// Same order as DefaultMotionObject: position with the old speed, then speed. //
+void ParticleSystem::integrate(float delta)
+{
+#if PBC_PARTICLES_SSE
+	const std::size_t count = (_count + Lanes - 1) / Lanes * Lanes;
+	const __m128 dt = _mm_set1_ps(delta);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+
+	for (std::size_t i = 0; i < count; i += Lanes)
+	{
+		__m128 px = _mm_loadu_ps(&_positionX[i]);
+		__m128 py = _mm_loadu_ps(&_positionY[i]);
+		__m128 vx = _mm_loadu_ps(&_velocityX[i]);
+		__m128 vy = _mm_loadu_ps(&_velocityY[i]);
+		_mm_storeu_ps(&_previousX[i], px);
+		_mm_storeu_ps(&_previousY[i], py);
+
+		px = _mm_add_ps(px, _mm_mul_ps(vx, dt));
+		py = _mm_add_ps(py, _mm_mul_ps(vy, dt));
+		vx = _mm_add_ps(vx, _mm_mul_ps(_mm_loadu_ps(&_accelerationX[i]), dt));
+		vy = _mm_add_ps(vy, _mm_mul_ps(_mm_loadu_ps(&_accelerationY[i]), dt));
+		_mm_storeu_ps(&_positionX[i], px);
+		_mm_storeu_ps(&_positionY[i], py);
+		_mm_storeu_ps(&_velocityX[i], vx);
+		_mm_storeu_ps(&_velocityY[i], vy);
+
+		const __m128 alpha = _mm_add_ps(_mm_loadu_ps(&_alpha[i]), _mm_mul_ps(_mm_loadu_ps(&_alphaSpeed[i]), dt));
+		_mm_storeu_ps(&_alpha[i], _mm_min_ps(_mm_max_ps(alpha, zero), one));
+		_mm_storeu_ps(&_lifetime[i], _mm_sub_ps(_mm_loadu_ps(&_lifetime[i]), dt));
+		_mm_storeu_ps(&_frame[i], _mm_add_ps(_mm_loadu_ps(&_frame[i]), _mm_mul_ps(_mm_loadu_ps(&_frameSpeed[i]), dt)));
+	}
+#else
+	for (std::size_t i = 0; i < _count; ++i)
+	{
+		_previousX[i] = _positionX[i];
+		_previousY[i] = _positionY[i];
+		_positionX[i] += _velocityX[i] * delta;
+		_positionY[i] += _velocityY[i] * delta;
+		_velocityX[i] += _accelerationX[i] * delta;
+		_velocityY[i] += _accelerationY[i] * delta;
+		_alpha[i] = std::clamp(_alpha[i] + _alphaSpeed[i] * delta, 0.f, 1.f);
+		_lifetime[i] -= delta;
+		_frame[i] += _frameSpeed[i] * delta;
+	}
+#endif
+}
+
+void ParticleSystem::moveParticle(std::size_t from, std::size_t to)
+{
+	if (from == to)
+		return;
+
+	for (auto* array : { &_positionX, &_positionY, &_previousX, &_previousY, &_velocityX, &_velocityY, &_accelerationX,
+		&_accelerationY, &_alpha, &_alphaSpeed, &_lifetime, &_frame, &_frameSpeed, &_size })
+		(*array)[to] = (*array)[from];
+	_preset[to] = _preset[from];
+}
+
+// Faded out particles that cannot come back die with the expired ones. //
+void ParticleSystem::removeDead()
+{
+	for (std::size_t i = _count; i-- > 0;)
+	{
+		if (_lifetime[i] <= 0.f || (_alpha[i] <= 0.f && _alphaSpeed[i] <= 0.f))
+			moveParticle(--_count, i);
+	}
+}
+
+void ParticleSystem::update(const sf::Time& elapsedTime)
+{
+	if (_count == 0)
+		return;
+
+	PROFILE_ZONE("ParticleSystem::update");
+	integrate(elapsedTime.asSeconds());
+	removeDead();
+}
+
+ParticleSystem::Batch& ParticleSystem::findBatch(const sf::Texture* texture, const sf::BlendMode& blendMode)
+{
+	for (Batch& batch : _batches)
+		if (batch.texture == texture && batch.blendMode == blendMode)
+			return batch;
+
+	Batch& batch = _batches.emplace_back();
+	batch.texture = texture;
+	batch.blendMode = blendMode;
+	return batch;
+}
+
+void ParticleSystem::render(sf::RenderTarget& canvas, sf::RenderStates rs)
+{
+	if (_count == 0)
+		return;
+
+	PROFILE_ZONE("ParticleSystem::render");
+
+	for (Batch& batch : _batches)
+		batch.vertices.clear();
+
+	// Batch pointers are cached per preset, so the vector must not grow while they are used. //
+	_batches.reserve(_batches.size() + _presets.size());
+	std::vector<Batch*> presetBatches(_presets.size(), nullptr);
+	const float interpolation = GameController::instance().getInterpolationAlpha();
+
+	for (std::size_t i = 0; i < _count; ++i)
+	{
+		const ParticlePreset& preset = *_presets[_preset[i]];
+		Batch*& batch = presetBatches[_preset[i]];
+		if (batch == nullptr)
+			batch = std::addressof(findBatch(preset.region.texture.get(), preset.blendMode));
+
+		const float x = _previousX[i] + (_positionX[i] - _previousX[i]) * interpolation;
+		const float y = _previousY[i] + (_positionY[i] - _previousY[i]) * interpolation;
+		const float half = _size[i] * 0.5f;
+
+		sf::Color color = preset.color;
+		color.a = Uint8(float(color.a) * _alpha[i]);
+
+		sf::FloatRect tex = {};
+		if (preset.region.isValid())
+		{
+			const Uint32 frame = preset.loop ? Uint32(_frame[i]) % preset.frames : std::min(Uint32(_frame[i]), preset.frames - 1);
+			const float width = float(preset.region.rect.width) / float(preset.frames);
+			tex = { float(preset.region.rect.left) + width * float(frame), float(preset.region.rect.top), width, float(preset.region.rect.height) };
+		}
+
+		const sf::Vertex topLeft({ x - half, y - half }, color, { tex.left, tex.top });
+		const sf::Vertex bottomLeft({ x - half, y + half }, color, { tex.left, tex.top + tex.height });
+		const sf::Vertex topRight({ x + half, y - half }, color, { tex.left + tex.width, tex.top });
+		const sf::Vertex bottomRight({ x + half, y + half }, color, { tex.left + tex.width, tex.top + tex.height });
+		batch->vertices.insert(batch->vertices.end(), { topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight });
+	}
+
+	for (const Batch& batch : _batches)
+	{
+		if (batch.vertices.empty())
+			continue;
+
+		rs.texture = batch.texture;
+		rs.blendMode = batch.blendMode;
+		canvas.draw(batch.vertices.data(), batch.vertices.size(), sf::Triangles, rs);
+	}
+}
+
+void ParticleSystem::clear()
+{
+	_count = 0;
+	_presets.clear();
+	_batches.clear();
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "data.h"
+#include "texture_atlas.h"
+
+#include "utils/manager.h"
+#include "utils/rawtypes.h"
+#include "utils/rng.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+struct ParticleRange
+{
+	float min = 0;
+	float max = 0;
+
+	inline float operator() (RNG& rand) const { return min + (max - min) * rand.randomFloat(); }
+};
+
+
+/*
+	Emitter settings, read from the json files of the particles directories. Every file is an object
+	of presets by name:
+		"bubble.pop": {
+			"texture": "particles/spark.png", "rect": [0, 0, 64, 16], "frames": 4, "fps": 12, "loop": true,
+			"count": [24, 32], "lifetime": [0.4, 0.8], "speed": [120, 360], "angle": [0, 360],
+			"acceleration": [0, 900], "alpha": [1, 1], "alphaSpeed": [-1.5, -1], "size": [8, 14],
+			"color": [255, 255, 255], "blend": "add"
+		}
+	Ranges are [min, max] or a single number, acceleration is an [x, y] vector. Without a texture
+	particles are plain coloured squares. Frames are laid out horizontally inside 'rect', which
+	defaults to the whole texture.
+*/
+struct ParticlePreset
+{
+	TextureRegion region;
+	Uint32 frames = 1;
+	float fps = 0;
+	bool loop = true;
+
+	ParticleRange count = { 1, 1 };
+	ParticleRange lifetime = { 1, 1 };
+	ParticleRange speed = { 0, 0 };
+	ParticleRange angle = { 0, 360 };
+	sf::Vector2f acceleration = { 0, 0 };
+	ParticleRange alpha = { 1, 1 };
+	ParticleRange alphaSpeed = { 0, 0 };
+	ParticleRange size = { 8, 8 };
+	sf::Color color = sf::Color::White;
+	sf::BlendMode blendMode = sf::BlendAlpha;
+};
+
+
+class ParticlePresetManager : public Manager<ParticlePreset>
+{
+private:
+	static ParticlePresetManager Instance;
+
+public:
+	// Needs the GL thread: preset textures are resolved while loading. //
+	bool load(const ResourceLocation& location);
+
+	bool loadAll();
+
+private:
+	inline ParticlePresetManager() : Manager(nullptr) {}
+
+public:
+	static constexpr ParticlePresetManager& instance() { return Instance; }
+};
+
+
+
+/*
+	Particles stored as structure of arrays and integrated four at a time with SSE when available.
+	Dead particles are swap-removed, so the live ones are always packed at the front. Drawing builds
+	one triangle list per (texture, blend mode), a single call when the presets share an atlas page.
+*/
+class ParticleSystem
+{
+public:
+	static constexpr std::size_t DefaultMaxParticles = 16384;
+
+private:
+	static constexpr std::size_t Lanes = 4;
+
+	struct Batch
+	{
+		const sf::Texture* texture = nullptr;
+		sf::BlendMode blendMode;
+		std::vector<sf::Vertex> vertices;
+	};
+
+private:
+	std::vector<float> _positionX;
+	std::vector<float> _positionY;
+	std::vector<float> _previousX;
+	std::vector<float> _previousY;
+	std::vector<float> _velocityX;
+	std::vector<float> _velocityY;
+	std::vector<float> _accelerationX;
+	std::vector<float> _accelerationY;
+	std::vector<float> _alpha;
+	std::vector<float> _alphaSpeed;
+	std::vector<float> _lifetime;
+	std::vector<float> _frame;
+	std::vector<float> _frameSpeed;
+	std::vector<float> _size;
+	std::vector<Uint16> _preset;
+
+	// Presets in use, indexed by _preset. //
+	std::vector<std::shared_ptr<const ParticlePreset>> _presets;
+
+	std::size_t _count = 0;
+	std::size_t _maxParticles = DefaultMaxParticles;
+	std::vector<Batch> _batches;
+	RNG _rand;
+
+public:
+	ParticleSystem() = default;
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem(ParticleSystem&&) noexcept = default;
+	~ParticleSystem() = default;
+
+	ParticleSystem& operator= (const ParticleSystem&) = delete;
+	ParticleSystem& operator= (ParticleSystem&&) noexcept = default;
+
+public:
+	// Zero count uses the preset range. Returns how many were emitted, the rest is dropped at the limit. //
+	std::size_t emit(const std::shared_ptr<const ParticlePreset>& preset, const sf::Vector2f& position, std::size_t count = 0);
+	std::size_t emit(std::string_view presetName, const sf::Vector2f& position, std::size_t count = 0);
+
+	void update(const sf::Time& elapsedTime);
+
+	void render(sf::RenderTarget& canvas, sf::RenderStates rs);
+
+	void clear();
+
+public:
+	constexpr std::size_t size() const { return _count; }
+	constexpr bool empty() const { return _count == 0; }
+
+	constexpr std::size_t getMaxParticles() const { return _maxParticles; }
+	constexpr void setMaxParticles(std::size_t count) { _maxParticles = count; }
+
+private:
+	Uint16 presetIndex(const std::shared_ptr<const ParticlePreset>& preset);
+
+	void reserve(std::size_t count);
+	void integrate(float delta);
+	void removeDead();
+	void moveParticle(std::size_t from, std::size_t to);
+
+	Batch& findBatch(const sf::Texture* texture, const sf::BlendMode& blendMode);
+};
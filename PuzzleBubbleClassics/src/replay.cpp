@@ -0,0 +1,313 @@
+#include "replay.h"
+
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+
+namespace
+{
+	class Writer
+	{
+	private:
+		std::vector<std::byte> _data;
+
+	public:
+		inline const std::vector<std::byte>& data() const { return _data; }
+
+		inline void bytes(const void* src, std::size_t size)
+		{
+			const auto* begin = static_cast<const std::byte*>(src);
+			_data.insert(_data.end(), begin, begin + size);
+		}
+
+		template <std::integral _Ty>
+		inline void value(_Ty value)
+		{
+			for (std::size_t i = 0; i < sizeof(_Ty); ++i)
+				_data.push_back(std::byte(static_cast<std::make_unsigned_t<_Ty>>(value) >> (i * 8)));
+		}
+
+		inline void varint(Uint64 value)
+		{
+			do
+			{
+				Uint8 byte = Uint8(value & 0x7f);
+				value >>= 7;
+				_data.push_back(std::byte(value != 0 ? byte | 0x80 : byte));
+			} while (value != 0);
+		}
+	};
+
+	class Reader
+	{
+	private:
+		const std::vector<std::byte>& _data;
+		std::size_t _offset = 0;
+		bool _failed = false;
+
+	public:
+		inline explicit Reader(const std::vector<std::byte>& data) : _data(data) {}
+
+		constexpr bool failed() const { return _failed; }
+
+		inline bool bytes(void* dst, std::size_t size)
+		{
+			if (_failed || _offset + size > _data.size())
+				return _failed = true, false;
+			std::memcpy(dst, _data.data() + _offset, size);
+			_offset += size;
+			return true;
+		}
+
+		template <std::integral _Ty>
+		inline _Ty value()
+		{
+			std::make_unsigned_t<_Ty> result = 0;
+			for (std::size_t i = 0; i < sizeof(_Ty); ++i)
+			{
+				if (_failed || _offset >= _data.size())
+					return _failed = true, _Ty(0);
+				result |= std::make_unsigned_t<_Ty>(Uint8(_data[_offset++])) << (i * 8);
+			}
+			return static_cast<_Ty>(result);
+		}
+
+		inline Uint64 varint()
+		{
+			Uint64 result = 0;
+			for (unsigned int shift = 0; shift < 64; shift += 7)
+			{
+				const Uint8 byte = value<Uint8>();
+				if (_failed)
+					return 0;
+				result |= Uint64(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0)
+					return result;
+			}
+			_failed = true;
+			return 0;
+		}
+	};
+}
+
+
+static void writeEvent(Writer& writer, const sf::Event& event)
+{
+	writer.value(Uint8(event.type));
+	switch (event.type)
+	{
+		case sf::Event::KeyPressed:
+		case sf::Event::KeyReleased:
+			writer.value(Int16(event.key.code));
+			writer.value(Uint8((event.key.alt ? 1 : 0) | (event.key.control ? 2 : 0) | (event.key.shift ? 4 : 0) | (event.key.system ? 8 : 0)));
+			break;
+
+		case sf::Event::TextEntered:
+			writer.varint(event.text.unicode);
+			break;
+
+		case sf::Event::MouseMoved:
+			writer.value(Int16(event.mouseMove.x));
+			writer.value(Int16(event.mouseMove.y));
+			break;
+
+		case sf::Event::MouseButtonPressed:
+		case sf::Event::MouseButtonReleased:
+			writer.value(Uint8(event.mouseButton.button));
+			writer.value(Int16(event.mouseButton.x));
+			writer.value(Int16(event.mouseButton.y));
+			break;
+
+		default:
+			break;
+	}
+}
+
+static bool readEvent(Reader& reader, sf::Event& event)
+{
+	event = {};
+	event.type = static_cast<sf::Event::EventType>(reader.value<Uint8>());
+	switch (event.type)
+	{
+		case sf::Event::KeyPressed:
+		case sf::Event::KeyReleased:
+		{
+			event.key.code = static_cast<sf::Keyboard::Key>(reader.value<Int16>());
+			const Uint8 modifiers = reader.value<Uint8>();
+			event.key.alt = (modifiers & 1) != 0;
+			event.key.control = (modifiers & 2) != 0;
+			event.key.shift = (modifiers & 4) != 0;
+			event.key.system = (modifiers & 8) != 0;
+			break;
+		}
+
+		case sf::Event::TextEntered:
+			event.text.unicode = Uint32(reader.varint());
+			break;
+
+		case sf::Event::MouseMoved:
+			event.mouseMove.x = reader.value<Int16>();
+			event.mouseMove.y = reader.value<Int16>();
+			break;
+
+		case sf::Event::MouseButtonPressed:
+		case sf::Event::MouseButtonReleased:
+			event.mouseButton.button = static_cast<sf::Mouse::Button>(reader.value<Uint8>());
+			event.mouseButton.x = reader.value<Int16>();
+			event.mouseButton.y = reader.value<Int16>();
+			break;
+
+		case sf::Event::Closed:
+			break;
+
+		default:
+			return false;
+	}
+	return !reader.failed();
+}
+
+
+bool Replay::save(const Path& path) const
+{
+	Writer writer;
+	writer.bytes(Magic.data(), Magic.size());
+	writer.value(Version);
+	writer.value(Uint32(_stepTime.asMicroseconds()));
+	writer.value(Uint32(_seed));
+	writer.value(Uint32(_streams.size()));
+	for (const auto& stream : _streams)
+	{
+		const std::size_t length = std::min<std::size_t>(stream.name.size(), 0xff);
+		writer.value(Uint8(length));
+		writer.bytes(stream.name.data(), length);
+		writer.value(Uint32(stream.state));
+	}
+
+	const auto& events = _input.getEvents();
+	writer.value(Uint32(events.size()));
+	Uint64 tick = 0;
+	for (const auto& scripted : events)
+	{
+		writer.varint(scripted.tick - tick);
+		tick = scripted.tick;
+		writeEvent(writer, scripted.event);
+	}
+
+	std::ofstream os(path, std::ios::binary);
+	if (!os)
+	{
+		logger::error("Replay: Cannot write '{}'.", path.string());
+		return false;
+	}
+	os.write(reinterpret_cast<const char*>(writer.data().data()), std::streamsize(writer.data().size()));
+	return bool(os);
+}
+
+bool Replay::load(const Path& path)
+{
+	std::ifstream is(path, std::ios::binary);
+	if (!is)
+	{
+		logger::error("Replay: Cannot open '{}'.", path.string());
+		return false;
+	}
+
+	std::vector<char> raw{ std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>() };
+	std::vector<std::byte> data(raw.size());
+	std::memcpy(data.data(), raw.data(), raw.size());
+
+	Reader reader(data);
+	std::array<char, 4> magic = {};
+	reader.bytes(magic.data(), magic.size());
+	const Uint32 version = reader.value<Uint32>();
+	if (reader.failed() || magic != Magic || version != Version)
+	{
+		logger::error("Replay: '{}' is not a version {} replay.", path.string(), Version);
+		return false;
+	}
+
+	_stepTime = sf::microseconds(reader.value<Uint32>());
+	_seed = RNG::SeedType(reader.value<Uint32>());
+
+	_streams.clear();
+	const Uint32 streams = reader.value<Uint32>();
+	for (Uint32 i = 0; i < streams && !reader.failed(); ++i)
+	{
+		ReplayStream stream;
+		stream.name.resize(reader.value<Uint8>());
+		reader.bytes(stream.name.data(), stream.name.size());
+		stream.state = RNG::SeedType(reader.value<Uint32>());
+		_streams.push_back(std::move(stream));
+	}
+
+	_input.clear();
+	const Uint32 events = reader.value<Uint32>();
+	Uint64 tick = 0;
+	for (Uint32 i = 0; i < events && !reader.failed(); ++i)
+	{
+		tick += reader.varint();
+		sf::Event event;
+		if (!readEvent(reader, event))
+		{
+			logger::error("Replay: '{}' is corrupted at event {}.", path.string(), i);
+			return false;
+		}
+		_input.add(tick, event);
+	}
+
+	if (reader.failed())
+	{
+		logger::error("Replay: '{}' is truncated.", path.string());
+		return false;
+	}
+	return true;
+}
+
+void Replay::setStream(std::string_view name, RNG::SeedType state)
+{
+	auto it = std::find_if(_streams.begin(), _streams.end(), [name](const ReplayStream& stream) { return stream.name == name; });
+	if (it != _streams.end())
+		it->state = state;
+	else
+		_streams.push_back({ std::string(name), state });
+}
+
+std::optional<RNG::SeedType> Replay::getStream(std::string_view name) const
+{
+	auto it = std::find_if(_streams.begin(), _streams.end(), [name](const ReplayStream& stream) { return stream.name == name; });
+	if (it == _streams.end())
+		return {};
+	return it->state;
+}
+
+bool Replay::restoreStream(std::string_view name, RNG& rand) const
+{
+	auto state = getStream(name);
+	if (!state.has_value())
+		return false;
+
+	rand.setState(*state);
+	return true;
+}
+
+bool Replay::isRecordable(const sf::Event& event)
+{
+	switch (event.type)
+	{
+		case sf::Event::Closed:
+		case sf::Event::KeyPressed:
+		case sf::Event::KeyReleased:
+		case sf::Event::TextEntered:
+		case sf::Event::MouseMoved:
+		case sf::Event::MouseButtonPressed:
+		case sf::Event::MouseButtonReleased:
+			return true;
+
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "input_script.h"
+#include "utils/rng.h"
+
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+struct ReplayStream
+{
+	std::string name;
+	RNG::SeedType state = 0;
+};
+
+
+/*
+	Input of a session stamped with fixed step ticks plus the random state it started from.
+	Binary layout (little endian):
+		header: magic "PBCR", u32 version, u32 step microseconds, u32 level seed, u32 stream count
+		stream: u8 name length, name bytes, u32 state
+		events: u32 count, then per event a varint tick delta, u8 type and the type payload
+*/
+class Replay
+{
+public:
+	static constexpr std::array<char, 4> Magic = { 'P', 'B', 'C', 'R' };
+	static constexpr Uint32 Version = 1;
+
+private:
+	sf::Time _stepTime;
+	RNG::SeedType _seed = 0;
+	std::vector<ReplayStream> _streams;
+	InputScript _input;
+
+public:
+	Replay() = default;
+	Replay(const Replay&) = default;
+	Replay(Replay&&) noexcept = default;
+	~Replay() = default;
+
+	Replay& operator= (const Replay&) = default;
+	Replay& operator= (Replay&&) noexcept = default;
+
+public:
+	bool save(const Path& path) const;
+	bool load(const Path& path);
+
+	void setStream(std::string_view name, RNG::SeedType state);
+	std::optional<RNG::SeedType> getStream(std::string_view name) const;
+
+	// Restores 'rand' from the named stream, false when the replay does not have it. //
+	bool restoreStream(std::string_view name, RNG& rand) const;
+
+	// Only the event types InputScript knows are kept. //
+	static bool isRecordable(const sf::Event& event);
+
+public:
+	inline sf::Time getStepTime() const { return _stepTime; }
+	inline void setStepTime(sf::Time stepTime) { _stepTime = stepTime; }
+
+	constexpr RNG::SeedType getSeed() const { return _seed; }
+	constexpr void setSeed(RNG::SeedType seed) { _seed = seed; }
+
+	inline const std::vector<ReplayStream>& getStreams() const { return _streams; }
+
+	inline InputScript& getInput() { return _input; }
+	inline const InputScript& getInput() const { return _input; }
+
+	inline Uint64 getLastTick() const { return _input.empty() ? 0 : _input.getEvents().back().tick; }
+};
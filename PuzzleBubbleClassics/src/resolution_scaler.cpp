@@ -0,0 +1,96 @@
+#include "resolution_scaler.h"
+
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+void ResolutionScaler::setSettings(const ResolutionScalingSettings& settings)
+{
+	_settings = settings;
+	_settings.minScale = std::max(_settings.minScale, _settings.step);
+	_settings.maxScale = std::max(_settings.maxScale, _settings.minScale);
+	reset(_settings.enabled ? _scale : 1.f);
+}
+
+void ResolutionScaler::setLimit(float limit)
+{
+	_limit = std::max(limit, _settings.step);
+	if (const float scale = clampScale(_scale); scale != _scale)
+		change(scale);
+}
+
+bool ResolutionScaler::record(float load)
+{
+	if (!_settings.enabled || !std::isfinite(load))
+		return false;
+
+	_average = _hasAverage ? _average + (load - _average) * _settings.smoothing : load;
+	_hasAverage = true;
+
+	const sf::Time held = _sinceChange.getElapsedTime();
+	if (_average > _settings.lowerLoad && held >= _settings.lowerDelay)
+	{
+		// Cost scales with the pixel count, so a heavy overload drops several steps at once. //
+		const float target = _scale * std::sqrt(_settings.lowerLoad / _average);
+		const float scale = clampScale(std::min(target, _scale - _settings.step));
+		if (scale < _scale)
+		{
+			_lowers++;
+			change(scale);
+			return true;
+		}
+	}
+	else if (_average < _settings.raiseLoad && held >= _settings.raiseDelay)
+	{
+		const float scale = clampScale(_scale + _settings.step);
+		if (scale > _scale)
+		{
+			_raises++;
+			change(scale);
+			return true;
+		}
+	}
+	return false;
+}
+
+void ResolutionScaler::reset(float scale)
+{
+	_scale = clampScale(scale);
+	_average = 0;
+	_hasAverage = false;
+	_sinceChange.restart();
+}
+
+sf::Vector2u ResolutionScaler::getExtent(const sf::Vector2u& base) const
+{
+	// Even sizes, so the canvas centre stays on a pixel boundary. //
+	const auto scaled = [this](unsigned int size) { return std::max(2u, Uint32(std::lround(float(size) * _scale / 2.f)) * 2u); };
+	return { scaled(base.x), scaled(base.y) };
+}
+
+float ResolutionScaler::getCapacity(const sf::Vector2u& base, const sf::Vector2u& window) const
+{
+	if (!_settings.enabled || base.x == 0 || base.y == 0)
+		return 1;
+
+	// Past the window resolution the extra pixels would only be filtered away. //
+	const float native = std::max(float(window.x) / float(base.x), float(window.y) / float(base.y));
+	const float steps = std::ceil(std::min(native, _settings.maxScale) / _settings.step);
+	return std::max(1.f, steps * _settings.step);
+}
+
+float ResolutionScaler::clampScale(float scale) const
+{
+	const float upper = std::min(_settings.maxScale, _limit);
+	const float lower = std::min(_settings.minScale, upper);
+	scale = std::round(scale / _settings.step) * _settings.step;
+	return std::clamp(scale, lower, upper);
+}
+
+void ResolutionScaler::change(float scale)
+{
+	logger::info("ResolutionScaler: Canvas scale {:.3f} -> {:.3f} (load {:.2f}).", _scale, scale, _average);
+	reset(scale);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "utils/rawtypes.h"
+
+#include <SFML/System.hpp>
+
+
+struct ResolutionScalingSettings
+{
+	bool enabled = true;
+
+	// Bounds of the canvas scale, the upper one is also capped by the window size. //
+	float minScale = 0.5f;
+	float maxScale = 3.f;
+	float step = 0.125f;
+
+	// Fractions of the frame budget the averaged load has to leave to raise the scale, or exceed to lower it. //
+	float raiseLoad = 0.6f;
+	float lowerLoad = 0.9f;
+
+	// Weight of the newest sample in the moving average. //
+	float smoothing = 0.05f;
+
+	// Samples taken at the previous scale are dropped, and a new one has to hold for this long first. //
+	sf::Time lowerDelay = sf::milliseconds(500);
+	sf::Time raiseDelay = sf::seconds(2);
+};
+
+struct ResolutionScalingStats
+{
+	float scale = 1;
+	float averageLoad = 0;
+	Uint64 raises = 0;
+	Uint64 lowers = 0;
+};
+
+
+/*
+	Picks the internal resolution scale from a moving average of the frame load, the frame cost over its
+	budget. The two thresholds and the delays after every change keep it from oscillating: lowering reacts
+	within half a second, raising needs two seconds of headroom. Scales are multiples of the step.
+*/
+class ResolutionScaler
+{
+private:
+	ResolutionScalingSettings _settings;
+	float _scale = 1;
+	float _limit = 1;
+	float _average = 0;
+	bool _hasAverage = false;
+	sf::Clock _sinceChange;
+	Uint64 _raises = 0;
+	Uint64 _lowers = 0;
+
+public:
+	ResolutionScaler() = default;
+	ResolutionScaler(const ResolutionScaler&) = default;
+	ResolutionScaler(ResolutionScaler&&) noexcept = default;
+	~ResolutionScaler() = default;
+
+	ResolutionScaler& operator= (const ResolutionScaler&) = default;
+	ResolutionScaler& operator= (ResolutionScaler&&) noexcept = default;
+
+public:
+	void setSettings(const ResolutionScalingSettings& settings);
+
+	// Highest scale the canvases can hold, the scale is clamped to it. //
+	void setLimit(float limit);
+
+	// Returns whether the scale changed. //
+	bool record(float load);
+
+	void reset(float scale = 1);
+
+	sf::Vector2u getExtent(const sf::Vector2u& base) const;
+
+public:
+	constexpr const ResolutionScalingSettings& getSettings() const { return _settings; }
+	constexpr float getScale() const { return _scale; }
+	constexpr float getLimit() const { return _limit; }
+
+	inline ResolutionScalingStats getStats() const { return { _scale, _average, _raises, _lowers }; }
+
+	// Maximum scale worth allocating for a window, the settings bound included. //
+	float getCapacity(const sf::Vector2u& base, const sf::Vector2u& window) const;
+
+private:
+	float clampScale(float scale) const;
+	void change(float scale);
+};
@@ -0,0 +1,94 @@
+#include "resource_loader.h"
+
+
+ResourceLoader ResourceLoader::Instance;
+
+ResourceLoader::~ResourceLoader()
+{
+	for (auto& worker : _workers)
+		worker.request_stop();
+	_jobsCondition.notify_all();
+
+	// Workers wait on the queue members, they have to be joined before those are destroyed. //
+	_workers.clear();
+}
+
+bool ResourceLoader::poll(sf::Time budget)
+{
+	sf::Clock clock;
+	bool progress = false;
+
+	while (true)
+	{
+		std::shared_ptr<Slot> slot;
+		{
+			std::scoped_lock lock(_slotsMutex);
+			if (_slots.empty() || !_slots.front()->decoded)
+				break;
+
+			slot = std::move(_slots.front());
+			_slots.pop_front();
+		}
+
+		{
+			PROFILE_ZONE("resource.upload");
+			if (!slot->finish())
+				_failed++;
+		}
+		_completed++;
+		progress = true;
+
+		if (budget > sf::Time::Zero && clock.getElapsedTime() >= budget)
+			break;
+	}
+
+	return progress;
+}
+
+void ResourceLoader::waitAll()
+{
+	while (!isIdle())
+	{
+		if (!poll())
+			std::this_thread::yield();
+	}
+}
+
+void ResourceLoader::pushJob(std::function<void()>&& job)
+{
+	startWorkers();
+	{
+		std::scoped_lock lock(_jobsMutex);
+		_jobs.push(std::move(job));
+	}
+	_jobsCondition.notify_one();
+}
+
+void ResourceLoader::startWorkers()
+{
+	if (!_workers.empty())
+		return;
+
+	const unsigned int count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+	for (unsigned int i = 0; i < count; ++i)
+		_workers.emplace_back([this](std::stop_token stop) { workerLoop(stop); });
+}
+
+void ResourceLoader::workerLoop(std::stop_token stop)
+{
+	PROFILE_THREAD("resource loader");
+	while (!stop.stop_requested())
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock lock(_jobsMutex);
+			if (!_jobsCondition.wait(lock, stop, [this]() { return !_jobs.empty(); }))
+				return;
+
+			job = std::move(_jobs.front());
+			_jobs.pop();
+		}
+
+		job();
+	}
+}
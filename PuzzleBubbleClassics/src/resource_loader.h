@@ -0,0 +1,194 @@
+#pragma once
+
+#include "utils/logger.h"
+#include "utils/profiler.h"
+
+#include <SFML/System.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+enum class LoadStatus
+{
+	Pending,
+	Ready,
+	Failed
+};
+
+
+template <typename _Ty>
+class LoadHandle
+{
+public:
+	using ValueType = _Ty;
+	using Pointer = std::shared_ptr<ValueType>;
+
+private:
+	struct State
+	{
+		std::atomic<LoadStatus> status = LoadStatus::Pending;
+		Pointer value = nullptr;
+	};
+
+public:
+	friend class ResourceLoader;
+
+private:
+	std::shared_ptr<State> _state;
+
+public:
+	LoadHandle() = default;
+	LoadHandle(const LoadHandle&) = default;
+	LoadHandle(LoadHandle&&) noexcept = default;
+	~LoadHandle() = default;
+
+	LoadHandle& operator= (const LoadHandle&) = default;
+	LoadHandle& operator= (LoadHandle&&) noexcept = default;
+
+private:
+	inline explicit LoadHandle(std::shared_ptr<State> state) : _state(std::move(state)) {}
+
+public:
+	inline bool isValid() const { return _state != nullptr; }
+	inline LoadStatus getStatus() const { return _state == nullptr ? LoadStatus::Failed : _state->status.load(); }
+	inline bool isPending() const { return getStatus() == LoadStatus::Pending; }
+	inline bool isReady() const { return getStatus() == LoadStatus::Ready; }
+	inline bool isFailed() const { return getStatus() == LoadStatus::Failed; }
+
+	inline const Pointer& get() const
+	{
+		static const Pointer empty = nullptr;
+		return isReady() ? _state->value : empty;
+	}
+
+	// Must be called from the owning (main) thread, it runs the pending completions while waiting. //
+	const Pointer& wait() const;
+};
+
+
+
+class ResourceLoader
+{
+private:
+	static ResourceLoader Instance;
+
+private:
+	struct Slot
+	{
+		std::atomic<bool> decoded = false;
+		std::function<bool()> finish;
+	};
+
+private:
+	std::vector<std::jthread> _workers;
+	std::mutex _jobsMutex;
+	std::condition_variable_any _jobsCondition;
+	std::queue<std::function<void()>> _jobs;
+
+	std::mutex _slotsMutex;
+	std::deque<std::shared_ptr<Slot>> _slots;
+
+	std::size_t _submitted = 0;
+	std::size_t _completed = 0;
+	std::size_t _failed = 0;
+
+public:
+	ResourceLoader(const ResourceLoader&) = delete;
+	ResourceLoader(ResourceLoader&&) noexcept = delete;
+
+	ResourceLoader& operator= (const ResourceLoader&) = delete;
+	ResourceLoader& operator= (ResourceLoader&&) noexcept = delete;
+
+private:
+	ResourceLoader() = default;
+	~ResourceLoader();
+
+public:
+	/*
+		Runs 'decode' on a worker thread and then 'upload' on the thread that calls poll().
+		Completions are applied in submission order, so later loads of the same id still override earlier ones.
+	*/
+	template <typename _Ty, typename _DecodedTy>
+	LoadHandle<_Ty> submit(std::function<std::optional<_DecodedTy>()> decode, std::function<std::shared_ptr<_Ty>(_DecodedTy&)> upload)
+	{
+		auto state = std::make_shared<typename LoadHandle<_Ty>::State>();
+		auto decoded = std::make_shared<std::optional<_DecodedTy>>();
+		auto slot = std::make_shared<Slot>();
+
+		slot->finish = [state, decoded, upload = std::move(upload)]() {
+			if (decoded->has_value())
+				state->value = upload(decoded->value());
+
+			decoded->reset();
+			state->status = state->value != nullptr ? LoadStatus::Ready : LoadStatus::Failed;
+			return state->value != nullptr;
+		};
+
+		{
+			std::scoped_lock lock(_slotsMutex);
+			_slots.push_back(slot);
+		}
+		_submitted++;
+
+		pushJob([slot, decoded, decode = std::move(decode)]() {
+			PROFILE_ZONE("resource.decode");
+			try { *decoded = decode(); }
+			catch (const std::exception& ex)
+			{
+				logger::error("Resource loader decode error: {}", ex.what());
+			}
+			slot->decoded = true;
+		});
+
+		return LoadHandle<_Ty>(std::move(state));
+	}
+
+	// Loads that only have main thread work, like Lua scripts. //
+	template <typename _Ty>
+	inline LoadHandle<_Ty> submitMainThread(std::function<std::shared_ptr<_Ty>()> load)
+	{
+		return submit<_Ty, bool>([]() { return std::optional<bool>(true); }, [load = std::move(load)](bool&) { return load(); });
+	}
+
+	bool poll(sf::Time budget = sf::Time::Zero);
+
+	void waitAll();
+
+public:
+	constexpr std::size_t getSubmittedCount() const { return _submitted; }
+	constexpr std::size_t getCompletedCount() const { return _completed; }
+	constexpr std::size_t getFailedCount() const { return _failed; }
+
+	constexpr bool isIdle() const { return _completed >= _submitted; }
+
+	constexpr float getProgress() const { return _submitted == 0 ? 1.f : float(_completed) / float(_submitted); }
+
+private:
+	void pushJob(std::function<void()>&& job);
+	void startWorkers();
+	void workerLoop(std::stop_token stop);
+
+public:
+	static constexpr ResourceLoader& instance() { return Instance; }
+};
+
+
+template <typename _Ty>
+const typename LoadHandle<_Ty>::Pointer& LoadHandle<_Ty>::wait() const
+{
+	while (isPending())
+	{
+		if (!ResourceLoader::instance().poll())
+			std::this_thread::yield();
+	}
+	return get();
+}
@@ -0,0 +1,49 @@
+#include "scenario.h"
+
+#include "utils/profiler.h"
+
+
+void Scenario::render(sf::RenderTarget& canvas, sf::RenderStates rs)
+{
+	PROFILE_ZONE("Scenario::render");
+	rs.transform *= getTransform();
+
+	_staticLayers.render(canvas, rs);
+	_board.renderRestingBubbles(canvas, rs);
+	_arrow.render(canvas, rs);
+
+	// Flying bubbles go on one layer and the effects over them, a draw per texture and blend mode. //
+	{
+		SpriteBatch::Scope batch(_batch, canvas);
+		_batch.setLayer(0);
+		for (const auto& bubble : _falling)
+			bubble->render(canvas, rs);
+		for (const auto& bubble : _moving)
+			bubble->render(canvas, rs);
+		for (const auto& bubble : _remoteMoving)
+			bubble->render(canvas, rs);
+
+		_batch.setLayer(1);
+		for (const auto& animation : _animations)
+			animation->render(canvas, rs);
+		for (const auto& particle : _particles)
+			particle->render(canvas, rs);
+	}
+
+	_particleSystem.render(canvas, rs);
+	_remoteTimes.render(canvas, rs);
+}
+
+void Scenario::update(const sf::Time& elapsedTime)
+{
+	PROFILE_ZONE("Scenario::update");
+	for (const auto& animation : _animations)
+		animation->update(elapsedTime);
+
+	for (const auto& particle : _particles)
+		particle->update(elapsedTime);
+	_particles.remove_if([](const auto& particle) { return particle->isDead(); });
+
+	_particleSystem.update(elapsedTime);
+	_remoteTimes.update(elapsedTime);
+}
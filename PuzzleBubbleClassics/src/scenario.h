@@ -3,8 +3,12 @@
 #include "scenario_utils.h"
 #include "bubble_board.h"
 #include "particle.h"
+#include "particle_system.h"
 #include "arrow.h"
+#include "layer_cache.h"
+#include "replay.h"
 
+#include <format>
 #include <forward_list>
 
 
@@ -64,8 +68,14 @@ private:
 	std::forward_list<std::shared_ptr<Bubble>> _remoteMoving;
 	std::forward_list<std::shared_ptr<AnimationObject>> _animations;
 	std::forward_list<std::shared_ptr<Particle>> _particles;
+	ParticleSystem _particleSystem;
 	RemoteTimes _remoteTimes;
 
+	// Background, board edges and arrow base, drawn under everything else in scenario coordinates. //
+	LayerCache _staticLayers;
+
+	SpriteBatch _batch;
+
 public:
 
 public:
@@ -79,7 +89,70 @@ public:
 	inline const std::shared_ptr<BubbleGenerator>& getBubbleGenerator() const { return _bgen; }
 	constexpr Arrow& getArrow() { return _arrow; }
 	constexpr const Arrow& getArrow() const { return _arrow; }
+	constexpr ParticleSystem& getParticleSystem() { return _particleSystem; }
+	constexpr const ParticleSystem& getParticleSystem() const { return _particleSystem; }
 	constexpr RemoteTimes& getRemoteTimes() { return _remoteTimes; }
 	constexpr const RemoteTimes& getRemoteTimes() const { return _remoteTimes; }
 
+	constexpr LayerCache& getStaticLayers() { return _staticLayers; }
+
+	// The static layers are repainted at the next render when the size changes. //
+	inline void setSize(const sf::Vector2f& size)
+	{
+		_size = size;
+		_staticLayers.setBounds({ 0.f, 0.f, _size.x, _size.y });
+	}
+
+	inline void invalidateStaticLayers() { _staticLayers.invalidate(); }
+
+	// Draws what the scenario holds; the activity that hosts scenarios is not part of the tree yet. //
+	void render(sf::RenderTarget& canvas, sf::RenderStates rs) override;
+
+	// Advances the effects only, flying bubbles wait for the arrow and board logic. //
+	void update(const sf::Time& elapsedTime) override;
+
+	inline void emitPop(const Bubble& bubble) { _particleSystem.emit("bubble.pop", bubble.getPosition()); }
+	inline void emitFall(const Bubble& bubble) { _particleSystem.emit("bubble.fall", bubble.getPosition()); }
+
+	// Paused and finished boards stop changing once their last effects are gone, see GameActivity::isIdle. //
+	inline bool isAtRest() const
+	{
+		return (_state == State::Paused || utils::scenario::isFinalState(_state))
+			&& _moving.empty() && _falling.empty() && _remoteMoving.empty()
+			&& _animations.empty() && _particles.empty() && _particleSystem.empty()
+			&& _remoteTimes.isDead();
+	}
+
+public:
+	// Random streams are keyed by player so both boards of a versus match share one replay. //
+	inline void saveReplayState(Replay& replay) const
+	{
+		const auto key = [this](std::string_view stream) { return std::format("p{}.{}", static_cast<int>(_playerId), stream); };
+
+		replay.setSeed(_properties.getSeed());
+		replay.setStream(key("scenario"), _rand.getState());
+		if (_colors != nullptr)
+			replay.setStream(key("colors"), _colors->getRand().getState());
+		if (_bgen != nullptr)
+		{
+			replay.setStream(key("arrow"), _bgen->getRand(true).getState());
+			replay.setStream(key("board"), _bgen->getRand(false).getState());
+			replay.setStream(key("generator_colors"), _bgen->getColorRandomizer().getRand().getState());
+		}
+	}
+
+	inline void restoreReplayState(const Replay& replay)
+	{
+		const auto key = [this](std::string_view stream) { return std::format("p{}.{}", static_cast<int>(_playerId), stream); };
+
+		replay.restoreStream(key("scenario"), _rand);
+		if (_colors != nullptr)
+			replay.restoreStream(key("colors"), _colors->getRand());
+		if (_bgen != nullptr)
+		{
+			replay.restoreStream(key("arrow"), _bgen->getRand(true));
+			replay.restoreStream(key("board"), _bgen->getRand(false));
+			replay.restoreStream(key("generator_colors"), _bgen->getColorRandomizer().getRand());
+		}
+	}
 };
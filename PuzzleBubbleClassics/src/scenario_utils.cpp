@@ -1,25 +1,22 @@
 #include "scenario_utils.h"
 
 #include "scenario.h"
-#include "font.h"
 
 
 void RemoteTimes::init(Scenario& scenario)
 {
 //	_scenario = std::addressof(scenario);
-	_font = FontManager::instance().get(FontName.data());
+	_font = BitmapFontManager::instance().bake(FontName, CharacterSize, OutlineThickness);
 
-	_timesText.setFont(*_font);
+	_timesText.setFont(_font);
 	_timesText.setString("times");
 	_timesText.setFillColor({ 220, 200, 16 });
 	_timesText.setOutlineColor({ 0, 16, 196 });
-	_timesText.setOutlineThickness(1.f);
 	
-	_countText.setFont(*_font);
+	_countText.setFont(_font);
 	_countText.setString("0");
 	_countText.setFillColor({ 16, 200, 16 });
 	_countText.setOutlineColor({ 0, 16, 196 });
-	_countText.setOutlineThickness(1.f);
 	
 	setTimeToLeave(sf::Time::Zero);
 }
@@ -97,20 +94,7 @@ void RemoteTimes::render(sf::RenderTarget& canvas, sf::RenderStates rs)
 
 void RemoteTimes::updateTextsAlphas()
 {
-	auto color = _countText.getFillColor();
-	color.a = Uint8(getAlpha() * 255);
-	_countText.setFillColor(color);
-
-	color = _countText.getOutlineColor();
-	color.a = Uint8(getAlpha() * 255);
-	_countText.setOutlineColor(color);
-
-
-	color = _timesText.getFillColor();
-	color.a = Uint8(getAlpha() * 255);
-	_timesText.setFillColor(color);
-
-	color = _timesText.getOutlineColor();
-	color.a = Uint8(getAlpha() * 255);
-	_timesText.setOutlineColor(color);
+	// Only the vertex colors of the cached runs change, the texts are not laid out again. //
+	_countText.setAlpha(getAlpha());
+	_timesText.setAlpha(getAlpha());
 }
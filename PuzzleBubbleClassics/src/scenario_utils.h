@@ -1,6 +1,7 @@
 #pragma once
 
 #include "particle.h"
+#include "text_renderer.h"
 
 class Scenario;
 
@@ -9,15 +10,17 @@ class RemoteTimes : public Particle
 {
 private:
 	static constexpr std::string_view FontName = "bubble2";
+	static constexpr Uint32 CharacterSize = 30;
+	static constexpr float OutlineThickness = 1;
 
 private:
 	Reference<Scenario> _scenario;
 	unsigned int _count = 0;
-	sf::Text _countText;
-	sf::Text _timesText;
+	BitmapText _countText;
+	BitmapText _timesText;
 	float _max = .5f;
 
-	std::shared_ptr<sf::Font> _font;
+	std::shared_ptr<BitmapFont> _font;
 
 public:
 	RemoteTimes() = default;
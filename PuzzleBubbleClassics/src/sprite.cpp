@@ -1,36 +1,384 @@
 #include "sprite.h"
 
 #include "data.h"
+#include "jobs.h"
+#include "sprite_batch.h"
+#include "utils/profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <map>
+#include <mutex>
 
 
 TextureManager TextureManager::Instance;
 
+static bool loadImage(sf::Image& image, const ResourceLocation& location)
+{
+	if (!location.isArchived())
+		return image.loadFromFile(location.path().string());
+
+	const auto data = location.read();
+	return data.has_value() && image.loadFromMemory(data->data(), data->size());
+}
+
+// Reads the size from the PNG header, so images too big for an atlas are never decoded twice. //
+static std::optional<sf::Vector2u> readPngSize(const ResourceLocation& location)
+{
+	std::array<std::byte, 24> header;
+	if (location.isArchived())
+	{
+		const auto data = location.read();
+		if (!data.has_value() || data->size() < header.size())
+			return {};
+		std::copy_n(data->begin(), header.size(), header.begin());
+	}
+	else
+	{
+		std::ifstream file(location.path(), std::ios::binary);
+		if (!file.read(reinterpret_cast<char*>(header.data()), header.size()))
+			return {};
+	}
+
+	static constexpr std::array<Uint8, 8> Signature = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	for (std::size_t i = 0; i < Signature.size(); ++i)
+		if (Uint8(header[i]) != Signature[i])
+			return {};
+
+	const auto bigEndian = [&header](std::size_t offset) {
+		return (Uint32(header[offset]) << 24) | (Uint32(header[offset + 1]) << 16) | (Uint32(header[offset + 2]) << 8) | Uint32(header[offset + 3]);
+	};
+	return sf::Vector2u(bigEndian(16), bigEndian(20));
+}
+
+
+class TextureManager::CachedImage
+{
+private:
+	ResourceLocation _location;
+	std::once_flag _decoded;
+	sf::Image _image;
+	bool _valid = false;
+
+public:
+	inline explicit CachedImage(const ResourceLocation& location) : _location(location) {}
+
+	inline std::string key() const { return _location.path().generic_string(); }
+
+	// Safe to call from any thread, only the first caller decodes. //
+	const sf::Image* decode(std::atomic<Uint64>& decodes)
+	{
+		std::call_once(_decoded, [this, &decodes]() {
+			_valid = loadImage(_image, _location);
+			decodes++;
+		});
+		return _valid ? std::addressof(_image) : nullptr;
+	}
+};
+
+
+TextureManager::ImageCacheScope::ImageCacheScope() { TextureManager::instance()._imageScopes++; }
+TextureManager::ImageCacheScope::~ImageCacheScope()
+{
+	TextureManager& manager = TextureManager::instance();
+	if (--manager._imageScopes == 0)
+		manager.evictUnusedImages();
+}
+
+std::shared_ptr<TextureManager::CachedImage> TextureManager::acquireImage(const ResourceLocation& location)
+{
+	auto [it, inserted] = _images.try_emplace(location.path().generic_string());
+	if (inserted)
+		it->second.image = std::make_shared<CachedImage>(location);
+	else
+		_imageHits++;
+
+	it->second.references++;
+	return it->second.image;
+}
+
+void TextureManager::releaseImage(const std::string& key)
+{
+	auto it = _images.find(key);
+	if (it == _images.end())
+		return;
+
+	// Decoded pixels are not needed once uploaded, unless a scope keeps them for upcoming sub-rects. //
+	if (--it->second.references == 0 && _imageScopes == 0)
+	{
+		_images.erase(it);
+		_imageEvictions++;
+	}
+}
+
+void TextureManager::evictUnusedImages()
+{
+	_imageEvictions += std::erase_if(_images, [](const auto& entry) { return entry.second.references == 0; });
+}
+
+std::size_t TextureManager::measure(const std::string& tag, const sf::Texture& texture) const
+{
+	// Atlas pages stay resident while their atlas exists, evicting a tag would not free them. //
+	if (isAtlased(tag))
+		return 0;
+	return std::size_t(texture.getSize().x) * texture.getSize().y * 4;
+}
+
+void TextureManager::clear()
+{
+	Manager::clear();
+	_regions.clear();
+}
+
+TextureManager::Pointer TextureManager::reload(const std::string& tag)
+{
+	auto it = _sources.find(tag);
+	if (it == _sources.end())
+		return nullptr;
+
+	const TextureSource source = it->second;
+	if (!load(source.path, tag, source.dims))
+		return nullptr;
+	return get(tag);
+}
+
 bool TextureManager::load(const Path& filepath, const std::string& tag, const sf::IntRect& dims)
 {
+	PROFILE_ZONE("TextureManager::load");
+	if (_regions.contains(tag))
+		return false;
+
+	auto location = DataPool::instance().findFile(ResourceDirectoryType::Textures, filepath.string());
+	if (location.has_value())
+	{
+		if (auto region = findAtlasRegion(*location, dims); region.has_value())
+		{
+			if (contains(tag))
+				return false;
+
+			// The page is stored under the tag too, so get() and contains() agree with load(). //
+			_regions.insert({ tag, *region });
+			insert(tag, region->texture);
+			return true;
+		}
+	}
+
 	auto tex = emplace(tag);
 	if (tex)
 	{
-		auto path = DataPool::instance().findFilePath(ResourceDirectoryType::Textures, filepath.string());
-		if (!path.has_value() || !tex->loadFromFile(path->string(), dims))
+		_sources.insert_or_assign(tag, TextureSource{ filepath, dims });
+
+		if (!location.has_value())
+		{
+			destroy(tag);
+			return false;
+		}
+
+		auto image = acquireImage(*location);
+		const sf::Image* decoded = image->decode(_imageDecodes);
+		const bool loaded = decoded != nullptr && tex->loadFromImage(*decoded, dims);
+		releaseImage(image->key());
+
+		if (!loaded)
 		{
 			destroy(tag);
 			return false;
 		}
+
+		// The texture had no size yet when it was stored. //
+		remeasure(tag);
 		return true;
 	}
 	return false;
 }
 
+LoadHandle<sf::Texture> TextureManager::loadAsync(const Path& filepath, const std::string& tag, const sf::IntRect& dims)
+{
+	auto location = DataPool::instance().findFile(ResourceDirectoryType::Textures, filepath.string());
+	if (!location.has_value())
+	{
+		logger::error("Texture: Cannot find texture file '{}'.", filepath.string());
+		return {};
+	}
+
+	// Packed files are already resident: the handle completes with the page, getRegion() gives the area. //
+	if (auto region = findAtlasRegion(*location, dims); region.has_value())
+	{
+		_regions.insert_or_assign(tag, *region);
+		insert(tag, region->texture);
+		return ResourceLoader::instance().submit<sf::Texture, Pointer>(
+			[texture = region->texture]() -> std::optional<Pointer> { return texture; },
+			[](Pointer& texture) -> Pointer { return texture; }
+		);
+	}
+	_sources.insert_or_assign(tag, TextureSource{ filepath, dims });
+
+	// Submissions for the same file share the decode; the reference is dropped after upload even on failure. //
+	return ResourceLoader::instance().submit<sf::Texture, std::shared_ptr<CachedImage>>(
+		[this, image = acquireImage(*location)]() -> std::optional<std::shared_ptr<CachedImage>> {
+			image->decode(_imageDecodes);
+			return image;
+		},
+		[this, tag, dims](std::shared_ptr<CachedImage>& image) -> Pointer {
+			const sf::Image* decoded = image->decode(_imageDecodes);
+			auto texture = std::make_shared<sf::Texture>();
+			const bool loaded = decoded != nullptr && texture->loadFromImage(*decoded, dims);
+			releaseImage(image->key());
+
+			if (!loaded)
+				return nullptr;
+			return insert(tag, texture);
+		}
+	);
+}
+
+TextureRegion TextureManager::getRegion(std::string_view tag)
+{
+	if (auto it = _regions.find(tag); it != _regions.end())
+		return it->second;
+
+	auto texture = Manager::get(tag);
+	if (texture == nullptr)
+		return {};
+	return { texture, { 0, 0, int(texture->getSize().x), int(texture->getSize().y) } };
+}
+
+TextureManager::Pointer TextureManager::get(std::string_view tag)
+{
+	if (isAtlased(tag))
+	{
+		logger::error("Texture: '{}' is packed into an atlas, resolve it through getRegion().", tag);
+		return nullptr;
+	}
+	return Manager::get(tag);
+}
+
+TextureManager::ConstPointer TextureManager::get(std::string_view tag) const
+{
+	if (isAtlased(tag))
+	{
+		logger::error("Texture: '{}' is packed into an atlas, resolve it through getRegion().", tag);
+		return nullptr;
+	}
+	return Manager::get(tag);
+}
+
+std::optional<TextureRegion> TextureManager::findAtlasRegion(const ResourceLocation& location, const sf::IntRect& dims) const
+{
+	auto it = _atlasFiles.find(location.path().generic_string());
+	if (it == _atlasFiles.end())
+		return {};
+
+	// Same rule as sf::Texture::loadFromImage: an empty area means the whole image. //
+	TextureRegion region = it->second;
+	if (dims.width <= 0 || dims.height <= 0)
+		return region;
+
+	if (dims.left < 0 || dims.top < 0 || dims.left + dims.width > region.rect.width || dims.top + dims.height > region.rect.height)
+		return {};
+
+	region.rect = { region.rect.left + dims.left, region.rect.top + dims.top, dims.width, dims.height };
+	return region;
+}
+
+bool TextureManager::packAtlases()
+{
+	PROFILE_ZONE("TextureManager::packAtlases");
+
+	std::map<std::size_t, std::vector<ResourceLocation>> packages;
+	DataPool::instance().forEachIndexedFile(ResourceDirectoryType::Textures, [&packages](const ResourceLocation& location, std::size_t priority) {
+		if (!utils::path::hasExtension(location.path(), ".png"))
+			return;
+
+		const auto size = readPngSize(location);
+		if (size.has_value() && TextureAtlas::canPack(*size))
+			packages[priority].push_back(location);
+	});
+
+	std::vector<TextureAtlas> atlases;
+	for (auto& [priority, locations] : packages)
+	{
+		// Sorted so the layout does not depend on the index order. //
+		std::sort(locations.begin(), locations.end(), [](const ResourceLocation& left, const ResourceLocation& right) { return left.path() < right.path(); });
+
+		std::vector<TextureAtlasImage> images(locations.size());
+		JobSystem::instance().parallelFor(locations.size(), [&images, &locations](std::size_t index) {
+			images[index].key = locations[index].path().generic_string();
+			if (!loadImage(images[index].image, locations[index]))
+				logger::warn("Texture: Cannot decode '{}' for the atlas.", locations[index].path().string());
+		});
+
+		TextureAtlas atlas;
+		if (atlas.pack(images) > 0)
+			atlases.push_back(std::move(atlas));
+	}
+
+	_atlases = std::move(atlases);
+	return true;
+}
+
+bool TextureManager::uploadAtlases()
+{
+	_atlasFiles.clear();
+
+	bool result = true;
+	std::size_t pages = 0;
+	std::size_t files = 0;
+	for (TextureAtlas& atlas : _atlases)
+	{
+		if (!atlas.upload())
+			result = false;
+
+		atlas.forEachRegion([this, &files](const std::string& key, const TextureRegion& region) {
+			_atlasFiles.insert_or_assign(key, region);
+			files++;
+		});
+		pages += atlas.getPageCount();
+	}
+
+	logger::info("Texture: {} files packed in {} atlas pages.", files, pages);
+	return result;
+}
+
 
 void AbstractSprite::setTexture(const sf::Texture& texture, bool resetRect)
 {
+	if (_regionOrigin != sf::Vector2i())
+	{
+		_regionOrigin = {};
+		updateTexCoords();
+	}
+
 	if (resetRect || (!_texture && (_textureRect == sf::IntRect())))
 		setTextureRect({ 0, 0, int(texture.getSize().x), int(texture.getSize().y) });
 
 	_texture = std::addressof(texture);
 }
 
+void AbstractSprite::setTexture(const TextureRegion& region)
+{
+	_texture = region.texture.get();
+	_regionOrigin = { region.rect.left, region.rect.top };
+	_textureRect = { 0, 0, region.rect.width, region.rect.height };
+	updateTexCoords();
+}
+
+void AbstractSprite::getQuad(sf::Vertex (&quad)[4], const sf::Transform& transform) const
+{
+	syncFrame();
+
+	const sf::Transform combined = transform * getTransform();
+	for (std::size_t i = 0; i < 4; ++i)
+		quad[i] = { combined.transformPoint(_vertices[i].position), _vertices[i].color, _vertices[i].texCoords };
+}
+
 void AbstractSprite::setTextureRect(const sf::IntRect& rectangle)
+{
+	applyTextureRect(rectangle);
+}
+
+void AbstractSprite::applyTextureRect(const sf::IntRect& rectangle) const
 {
 	if (rectangle != _textureRect)
 	{
@@ -56,9 +404,16 @@ void AbstractSprite::draw(sf::RenderTarget& target, sf::RenderStates rs) const
 {
 	if (_texture != nullptr)
 	{
+		syncFrame();
+
 		rs.transform *= getTransform();
 		rs.texture = &_texture;
-		target.draw(_vertices, 4, sf::TriangleStrip, rs);
+
+		SpriteBatch* batch = SpriteBatch::current();
+		if (batch != nullptr && batch->isTarget(target) && rs.shader == nullptr)
+			batch->submit(_vertices, rs);
+		else
+			target.draw(_vertices, 4, sf::TriangleStrip, rs);
 	}
 }
 
@@ -70,11 +425,11 @@ void AbstractSprite::updatePositions()
 	_vertices[3].position = { _width, _height };
 }
 
-void AbstractSprite::updateTexCoords()
+void AbstractSprite::updateTexCoords() const
 {
-	float left = float(_textureRect.left);
+	float left = float(_regionOrigin.x + _textureRect.left);
 	float right = left + _textureRect.width;
-	float top = float(_textureRect.top);
+	float top = float(_regionOrigin.y + _textureRect.top);
 	float bottom = top + _textureRect.height;
 
 	_vertices[0].texCoords = { left, top };
@@ -85,46 +440,45 @@ void AbstractSprite::updateTexCoords()
 
 
 
-void AnimatedSprite::update(const sf::Time& elapsedTime)
+std::size_t AnimatedSprite::getFrameAt(const sf::Time& time) const
 {
-	if (_end)
-		return;
-
-	_it += elapsedTime.asSeconds();
-	if (hasMoreFrames())
-	{
-		updateTextureRect();
-		return;
-	}
+	if (!_playing || _speed == 0 || time <= _start)
+		return _playing ? (_speed < 0 ? _framesCount - 1 : 0) : _heldFrame;
 
+	std::size_t frame = std::size_t((time - _start).asSeconds() * std::abs(_speed));
 	if (_loop)
-	{
-		while (!hasMoreFrames())
-			_it = (_it < 0 ? _it + _framesCount : std::fmod(_it, float(_framesCount)));
-		updateTextureRect();
-		return;
-	}
-	_end = true;
+		frame %= _framesCount;
+	else
+		frame = std::min(frame, _framesCount - 1);
+
+	return _speed < 0 ? _framesCount - 1 - frame : frame;
 }
 
+bool AnimatedSprite::isFinishedAt(const sf::Time& time) const
+{
+	if (!_playing)
+		return true;
+	if (_loop || _speed == 0)
+		return false;
+	return time - _start >= getDuration();
+}
 
 
-void RandomAnimatedSprite::update(const sf::Time& elapsedTime)
-{
-	if (isWaiting())
-	{
-		_current -= elapsedTime;
-		return;
-	}
 
-	setLoopEnabled(false);
-	AnimatedSprite::update(elapsedTime);
+void RandomAnimatedSprite::scheduleNext(const sf::Time& from)
+{
+	_nextStart = from + (_max - _min) * _rand.randomFloat() + _min;
+	_timer = AnimationClock::instance().scheduleAt(_nextStart, [this](const sf::Time& deadline) {
+		_timer = InvalidTimer;
+		play(deadline);
+		scheduleNext(deadline + getDuration());
+	});
+}
 
-	if (isFinished())
-	{
-		rewind();
-		_current = (_max - _min) * _rand.randomFloat() + _min;
-	}
+sf::Time RandomAnimatedSprite::getRemainingTime() const
+{
+	const sf::Time now = AnimationClock::instance().now();
+	return isFinishedAt(now) && _nextStart > now ? _nextStart - now : sf::Time::Zero;
 }
 
 
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "animation_clock.h"
 #include "object_basics.h"
+#include "resource_loader.h"
+#include "texture_atlas.h"
 
 #include "utils/manager.h"
 #include "utils/path.h"
@@ -10,15 +13,102 @@
 
 #include <SFML/Graphics.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+
+class ResourceLocation;
 
 class TextureManager : public Manager<sf::Texture>
 {
+public:
+	struct ImageCacheStats
+	{
+		Uint64 decodes = 0;
+		Uint64 hits = 0;
+		Uint64 evictions = 0;
+	};
+
+	/*
+		Keeps decoded images alive while in scope, so several tags or sub-rects of the same sheet
+		share a single decode even when they are loaded one after another.
+	*/
+	class ImageCacheScope
+	{
+	public:
+		ImageCacheScope();
+		ImageCacheScope(const ImageCacheScope&) = delete;
+		ImageCacheScope(ImageCacheScope&&) noexcept = delete;
+		~ImageCacheScope();
+
+		ImageCacheScope& operator= (const ImageCacheScope&) = delete;
+		ImageCacheScope& operator= (ImageCacheScope&&) noexcept = delete;
+	};
+
+private:
+	class CachedImage;
+
+	struct ImageCacheEntry
+	{
+		std::shared_ptr<CachedImage> image;
+		Uint32 references = 0;
+	};
+
+	struct TextureSource
+	{
+		Path path;
+		sf::IntRect dims;
+	};
+
 private:
 	static TextureManager Instance;
 
+private:
+	std::unordered_map<std::string, TextureSource> _sources;
+	std::unordered_map<std::string, ImageCacheEntry> _images;
+
+	std::vector<TextureAtlas> _atlases;
+	std::unordered_map<std::string, TextureRegion> _atlasFiles;
+	std::unordered_map<std::string, TextureRegion, utils::manager::StringHash, std::equal_to<>> _regions;
+	Uint32 _imageScopes = 0;
+	std::atomic<Uint64> _imageDecodes = 0;
+	Uint64 _imageHits = 0;
+	Uint64 _imageEvictions = 0;
+
 public:
 	bool load(const Path& filepath, const std::string& tag, const sf::IntRect& dims);
 
+	LoadHandle<sf::Texture> loadAsync(const Path& filepath, const std::string& tag, const sf::IntRect& dims = {});
+
+	/*
+		Packs every small enough texture file into one atlas per resource package. It only decodes, so it
+		may run on a worker while nothing else uses the manager; uploadAtlases() follows on the GL thread.
+		Tags loaded from packed files afterwards resolve to a page area through getRegion(). They are
+		contained but get() refuses them, their page would be drawn whole: use Sprite::makeStatic(tag).
+	*/
+	bool packAtlases();
+	bool uploadAtlases();
+
+	// Atlas page area for tags of packed files, the whole texture otherwise. //
+	TextureRegion getRegion(std::string_view tag);
+
+	using Manager::get;
+
+	// Null with an error for tags of packed files. //
+	Pointer get(std::string_view tag);
+	ConstPointer get(std::string_view tag) const;
+
+	void clear() override;
+
+	inline ImageCacheStats getImageCacheStats() const { return { _imageDecodes.load(), _imageHits, _imageEvictions }; }
+	inline std::size_t getCachedImageCount() const { return _images.size(); }
+
+	inline bool isAtlased(std::string_view tag) const { return _regions.contains(tag); }
+	inline std::size_t getAtlasCount() const { return _atlases.size(); }
+
 public:
 	inline bool load(const Path& filepath, const std::string& tag) { return load(filepath, tag, {}); }
 	inline bool load(const Path& filepath, const std::string& tag, int x, int y, int width, int height) { return load(filepath, tag, { x, y, width, height }); }
@@ -26,6 +116,15 @@ public:
 private:
 	inline explicit TextureManager() : Manager(nullptr) {}
 
+	std::size_t measure(const std::string& tag, const sf::Texture& texture) const override;
+	Pointer reload(const std::string& tag) override;
+
+	std::optional<TextureRegion> findAtlasRegion(const ResourceLocation& location, const sf::IntRect& dims) const;
+
+	std::shared_ptr<CachedImage> acquireImage(const ResourceLocation& location);
+	void releaseImage(const std::string& key);
+	void evictUnusedImages();
+
 public:
 	static constexpr TextureManager& instance() { return Instance; }
 };
@@ -62,9 +161,12 @@ public:
 
 private:
 	Type _type;
-	sf::Vertex _vertices[4];
 	ConstReference<sf::Texture> _texture = nullptr;
-	sf::IntRect _textureRect = {};
+
+	// Animated sprites resolve their frame when drawn. //
+	mutable sf::Vertex _vertices[4];
+	mutable sf::IntRect _textureRect = {};
+	sf::Vector2i _regionOrigin = {};
 	float _width = 1;
 	float _height = 1;
 
@@ -115,7 +217,9 @@ public:
 	constexpr bool hasTexture() const { return _texture != nullptr; }
 	constexpr ConstReference<sf::Texture> getTexture() const { return _texture; }
 
+	// Relative to the texture region, when the sprite was given one. Animated sprites report the last frame drawn. //
 	constexpr const sf::IntRect& getTextureRect() const { return _textureRect; }
+	constexpr const sf::Vector2i& getTextureRegionOrigin() const { return _regionOrigin; }
 
 	inline void setColor(const sf::Color& color)
 	{
@@ -135,6 +239,12 @@ public:
 public:
 	void setTexture(const sf::Texture& texture, bool resetRect = false);
 
+	// Texture rects become relative to 'region', which is also the initial rect. //
+	void setTexture(const TextureRegion& region);
+
+	// Quad in TriangleStrip order, with the sprite transform and then 'transform' applied. //
+	void getQuad(sf::Vertex (&quad)[4], const sf::Transform& transform = sf::Transform::Identity) const;
+
 	void setTextureRect(const sf::IntRect& rectangle);
 
 	void setSize(float width, float height);
@@ -142,10 +252,15 @@ public:
 private:
 	virtual AbstractSprite* copy() const = 0;
 
+	// Brings the texture rect up to date before the sprite is drawn or its quad is read. //
+	virtual void syncFrame() const {}
+
 	void draw(sf::RenderTarget& target, sf::RenderStates rs) const override;
 
+	void applyTextureRect(const sf::IntRect& rectangle) const;
+
 	void updatePositions();
-	void updateTexCoords();
+	void updateTexCoords() const;
 };
 
 
@@ -193,12 +308,17 @@ public:
 	friend std::default_delete<AnimatedSprite>;
 
 private:
+	/*
+		Frames are laid out horizontally from the first one. Nothing is stepped per update: the frame is
+		derived from the start time and the AnimationClock when the sprite is drawn.
+	*/
 	sf::IntRect _firstFrame = { 0, 0, 1, 1 };
 	std::size_t _framesCount = 1;
 	float _speed = 1;
 	bool _loop = false;
-	bool _end = true;
-	float _it = 0;
+	bool _playing = false;
+	sf::Time _start;
+	std::size_t _heldFrame = 0;
 
 protected:
 	inline explicit AnimatedSprite(Type type) : AbstractSprite(type) { updateTextureRect(); }
@@ -226,16 +346,24 @@ private:
 	AnimatedSprite& operator= (AnimatedSprite&&) noexcept = delete;
 
 public:
-	constexpr bool isFinished() const { return _end; }
+	inline bool isFinished() const { return isFinishedAt(AnimationClock::instance().now()); }
+	inline bool isPlaying() const { return !isFinished(); }
 
 	constexpr std::size_t getFramesCount() const { return _framesCount; }
+	inline void setFramesCount(std::size_t count) { _framesCount = std::max<std::size_t>(count, 1), _heldFrame = std::min(_heldFrame, _framesCount - 1), updateTextureRect(); }
 
+	// Frames per second, negative speeds play backwards. //
 	constexpr void setSpeed(float speed) { _speed = speed; }
 	constexpr float getSpeed() const { return _speed; }
 
 	constexpr void setLoopEnabled(bool enabled) { _loop = enabled; }
 	constexpr bool isLoopEnabled() const { return _loop; }
 
+	constexpr const sf::Time& getStartTime() const { return _start; }
+	inline sf::Time getDuration() const { return _speed == 0 ? sf::Time::Zero : sf::seconds(float(_framesCount) / std::abs(_speed)); }
+
+	inline std::size_t getCurrentFrame() const { return getFrameAt(AnimationClock::instance().now()); }
+
 	inline void setFirstFrameRect(const sf::IntRect& rect) { _firstFrame = rect, updateTextureRect(); }
 	inline void setFrameSize(int width, int height) { _firstFrame.width = width, _firstFrame.height = height, updateTextureRect(); }
 	inline void setFirstFramePosition(int x, int y) { _firstFrame.left = x, _firstFrame.top = y, updateTextureRect(); }
@@ -249,23 +377,35 @@ public:
 	constexpr Dimensions2<int> getFrameSize() const { return { _firstFrame.width, _firstFrame.height }; }
 	constexpr Dimensions2<int> getFirstFramePosition() const { return { _firstFrame.left, _firstFrame.top }; }
 
-	inline void rewind() { _it = 0, _end = false, updateTextureRect(); }
-	inline void fastForward() { _it = float(_framesCount), _end = true, updateTextureRect(); }
+	// Plays from the first frame, starting now or at a given clock time. //
+	inline void rewind() { play(AnimationClock::instance().now()); }
+	inline void play(const sf::Time& start) { _start = start, _playing = true, updateTextureRect(), AnimationClock::instance().requestFrame(); }
 
-public:
-	void update(const sf::Time& elapsedTime) override;
+	// Stops on the last frame. //
+	inline void fastForward() { _playing = false, _heldFrame = _framesCount - 1, updateTextureRect(); }
+
+	std::size_t getFrameAt(const sf::Time& time) const;
+	bool isFinishedAt(const sf::Time& time) const;
 
 private:
-	constexpr bool hasMoreFrames() const { return _it >= 0 && std::size_t(_it) < _framesCount; }
+	inline void updateTextureRect() const { applyTextureRect(getFrameRect(getCurrentFrame())); }
 
-	inline void updateTextureRect()
+	inline sf::IntRect getFrameRect(std::size_t frame) const
 	{
-		setTextureRect({
-			_firstFrame.left + int(_it),
+		return {
+			_firstFrame.left + int(frame) * _firstFrame.width,
 			_firstFrame.top,
 			_firstFrame.width,
 			_firstFrame.height
-			});
+		};
+	}
+
+	// A sprite drawn while playing asks for the next frame too. //
+	inline void syncFrame() const override
+	{
+		updateTextureRect();
+		if (isPlaying())
+			AnimationClock::instance().requestFrame();
 	}
 
 private:
@@ -287,29 +427,39 @@ public:
 	friend std::default_delete<RandomAnimatedSprite>;
 
 private:
+	/*
+		Plays once, then waits a random delay before playing again. Each start is a timer of the
+		AnimationClock wheel, so waiting sprites cost nothing per update. Timers are armed on creation
+		and belong to the update thread, the clock refuses them from any other one.
+	*/
 	sf::Time _min = sf::Time::Zero;
 	sf::Time _max = sf::seconds(10);
-	sf::Time _current = sf::Time::Zero;
+	sf::Time _nextStart;
+	TimerId _timer = InvalidTimer;
 	RNG _rand;
 
 private:
-	inline RandomAnimatedSprite() : AnimatedSprite(Type::RandomAnimated) {}
-	inline RandomAnimatedSprite(const sf::Texture& texture) : AnimatedSprite(Type::RandomAnimated, texture) {}
-	inline RandomAnimatedSprite(const sf::Texture& texture, const sf::IntRect& rectangle) : AnimatedSprite(Type::RandomAnimated, texture, rectangle) {}
-	inline RandomAnimatedSprite(const sf::Vector2f& size) : AnimatedSprite(Type::RandomAnimated, size) {}
-	inline RandomAnimatedSprite(const sf::Vector2f& size, const sf::Texture& texture) : AnimatedSprite(Type::RandomAnimated, size, texture) {}
-	inline RandomAnimatedSprite(const sf::Vector2f& size, const sf::Texture& texture, const sf::IntRect& rectangle) : AnimatedSprite(Type::RandomAnimated, size, texture, rectangle) {}
-	virtual ~RandomAnimatedSprite() = default;
+	inline RandomAnimatedSprite() : AnimatedSprite(Type::RandomAnimated) { arm(); }
+	inline RandomAnimatedSprite(const sf::Texture& texture) : AnimatedSprite(Type::RandomAnimated, texture) { arm(); }
+	inline RandomAnimatedSprite(const sf::Texture& texture, const sf::IntRect& rectangle) : AnimatedSprite(Type::RandomAnimated, texture, rectangle) { arm(); }
+	inline RandomAnimatedSprite(const sf::Vector2f& size) : AnimatedSprite(Type::RandomAnimated, size) { arm(); }
+	inline RandomAnimatedSprite(const sf::Vector2f& size, const sf::Texture& texture) : AnimatedSprite(Type::RandomAnimated, size, texture) { arm(); }
+	inline RandomAnimatedSprite(const sf::Vector2f& size, const sf::Texture& texture, const sf::IntRect& rectangle) : AnimatedSprite(Type::RandomAnimated, size, texture, rectangle) { arm(); }
+	inline virtual ~RandomAnimatedSprite() { AnimationClock::instance().cancel(_timer); }
 
 private:
-	RandomAnimatedSprite(const RandomAnimatedSprite&) = default;
-	RandomAnimatedSprite(RandomAnimatedSprite&&) noexcept = default;
+	/*
+		Copies arm their own timer, a pending one cannot be shared. The timer callback is bound to the
+		sprite address, so moves copy as well and may allocate: they are not noexcept.
+	*/
+	inline RandomAnimatedSprite(const RandomAnimatedSprite& right) : AnimatedSprite(right), _min(right._min), _max(right._max), _rand(right._rand) { arm(); }
+	inline RandomAnimatedSprite(RandomAnimatedSprite&& right) : RandomAnimatedSprite(std::as_const(right)) {}
 
 	RandomAnimatedSprite& operator= (const RandomAnimatedSprite&) = delete;
 	RandomAnimatedSprite& operator= (RandomAnimatedSprite&&) noexcept = delete;
 
-	inline explicit RandomAnimatedSprite(const AnimatedSprite& sprite) : AnimatedSprite(sprite) {}
-	inline explicit RandomAnimatedSprite(AnimatedSprite&& sprite) noexcept : AnimatedSprite(std::move(sprite)) {}
+	inline explicit RandomAnimatedSprite(const AnimatedSprite& sprite) : AnimatedSprite(sprite) { arm(); }
+	inline explicit RandomAnimatedSprite(AnimatedSprite&& sprite) : AnimatedSprite(std::move(sprite)) { arm(); }
 
 public:
 	constexpr const sf::Time& getMinRandomDelay() const { return _min; }
@@ -320,12 +470,27 @@ public:
 
 	constexpr void setRandomDelay(const sf::Time& min, const sf::Time& max) { _min = min, _max = max; }
 
-	constexpr const sf::Time& getRemainingTime() const { return _current; }
+	// Time left before the next play, zero while playing. //
+	sf::Time getRemainingTime() const;
 
-	inline bool isWaiting() const { return _current > sf::Time::Zero; }
+	inline bool isWaiting() const { return getRemainingTime() > sf::Time::Zero; }
 
-public:
-	void update(const sf::Time& elapsedTime) override;
+private:
+	inline void arm() { setLoopEnabled(false), scheduleNext(AnimationClock::instance().now()); }
+
+	void scheduleNext(const sf::Time& from);
+
+	// Waiting sprites rest on the first frame. //
+	inline void syncFrame() const override
+	{
+		if (isFinished())
+			applyTextureRect(getFrameRect(0));
+		else
+		{
+			applyTextureRect(getFrameRect(getCurrentFrame()));
+			AnimationClock::instance().requestFrame();
+		}
+	}
 
 private:
 	inline AbstractSprite* copy() const { return new RandomAnimatedSprite(*this); }
@@ -394,12 +559,15 @@ public:
 	inline const sf::Transform& getInverseTransform() const { return _sprite->getInverseTransform(); }
 
 	inline void setTexture(const sf::Texture& texture) { _sprite->setTexture(texture); }
+	inline void setTexture(const TextureRegion& region) { _sprite->setTexture(region); }
 	inline const sf::Texture& getTexture() const { return *_sprite->getTexture(); }
 	inline bool hasTexture() const { return _sprite->getTexture() != nullptr; }
 
 	inline void setTextureRect(const sf::IntRect& rectangle) { _sprite->setTextureRect(rectangle); }
 	inline const sf::IntRect& getTextureRect() const { return _sprite->getTextureRect(); }
 
+	inline void getQuad(sf::Vertex (&quad)[4], const sf::Transform& transform = sf::Transform::Identity) const { _sprite->getQuad(quad, transform); }
+
 	inline void setColor(const sf::Color& color) { _sprite->setColor(color); }
 	inline const sf::Color& getColor() const { return _sprite->getColor(); }
 
@@ -445,6 +613,12 @@ public:
 	inline static Sprite makeStatic(const sf::Vector2f& size) { return new StaticSprite(size); }
 	inline static Sprite makeStatic(const sf::Vector2f& size, const sf::Texture& texture) { return new StaticSprite(size, texture); }
 	inline static Sprite makeStatic(const sf::Vector2f& size, const sf::Texture& texture, const sf::IntRect& rectangle) { return new StaticSprite(size, texture, rectangle); }
+	inline static Sprite makeStatic(const TextureRegion& region) { return makeWithRegion(new StaticSprite(), region); }
+	inline static Sprite makeStatic(const sf::Vector2f& size, const TextureRegion& region) { return makeWithRegion(new StaticSprite(size), region); }
+
+	// Texture of a TextureManager tag, or its atlas area when the file was packed. //
+	inline static Sprite makeStatic(std::string_view textureTag) { return makeStatic(TextureManager::instance().getRegion(textureTag)); }
+	inline static Sprite makeStatic(const sf::Vector2f& size, std::string_view textureTag) { return makeStatic(size, TextureManager::instance().getRegion(textureTag)); }
 
 	inline static Sprite makeAnimated() { return new AnimatedSprite(); }
 	inline static Sprite makeAnimated(const sf::Texture& texture) { return new AnimatedSprite(texture); }
@@ -459,4 +633,13 @@ public:
 	inline static Sprite makeRandomAnimated(const sf::Vector2f& size) { return new RandomAnimatedSprite(size); }
 	inline static Sprite makeRandomAnimated(const sf::Vector2f& size, const sf::Texture& texture) { return new RandomAnimatedSprite(size, texture); }
 	inline static Sprite makeRandomAnimated(const sf::Vector2f& size, const sf::Texture& texture, const sf::IntRect& rectangle) { return new RandomAnimatedSprite(size, texture, rectangle); }
+
+private:
+	inline static Sprite makeWithRegion(AbstractSprite* sprite, const TextureRegion& region)
+	{
+		Sprite result = sprite;
+		if (region.isValid())
+			result.setTexture(region);
+		return result;
+	}
 };
@@ -0,0 +1,115 @@
+#include "sprite_batch.h"
+
+#include "utils/profiler.h"
+
+#include <algorithm>
+
+
+thread_local SpriteBatch* SpriteBatch::Current = nullptr;
+thread_local SpriteBatchStats SpriteBatch::Totals = {};
+
+
+SpriteBatch::Scope::Scope(SpriteBatch& batch, sf::RenderTarget& target) :
+	_batch(batch),
+	_previous(Current)
+{
+	if (_previous != nullptr)
+		_previous->flush();
+
+	_batch._target = &target;
+	_batch._frame = {};
+	Current = &_batch;
+}
+
+SpriteBatch::Scope::~Scope()
+{
+	_batch.flush();
+	_batch._last = _batch._frame;
+	_batch._target = nullptr;
+	Current = _previous;
+}
+
+
+void SpriteBatch::submit(const sf::Vertex (&quad)[4], const sf::RenderStates& rs)
+{
+	Group& group = findGroup(rs.texture, rs.blendMode);
+
+	sf::Vertex transformed[4];
+	for (std::size_t i = 0; i < 4; ++i)
+		transformed[i] = { rs.transform.transformPoint(quad[i].position), quad[i].color, quad[i].texCoords };
+
+	// Strip order 0-1-2-3 becomes triangles 0-1-2 and 2-1-3. //
+	group.vertices.insert(group.vertices.end(), {
+		transformed[0], transformed[1], transformed[2],
+		transformed[2], transformed[1], transformed[3]
+	});
+	_frame.quads++;
+	Totals.quads++;
+}
+
+void SpriteBatch::flush()
+{
+	if (_target == nullptr || _usedGroups == 0)
+		return;
+
+	PROFILE_ZONE("SpriteBatch::flush");
+
+	_drawOrder.resize(_usedGroups);
+	for (std::size_t i = 0; i < _usedGroups; ++i)
+		_drawOrder[i] = i;
+
+	std::sort(_drawOrder.begin(), _drawOrder.end(), [this](std::size_t left, std::size_t right) {
+		const Group& l = _groups[left];
+		const Group& r = _groups[right];
+		return l.layer != r.layer ? l.layer < r.layer : l.order < r.order;
+	});
+
+	for (std::size_t index : _drawOrder)
+	{
+		Group& group = _groups[index];
+		if (group.vertices.empty())
+			continue;
+
+		sf::RenderStates rs;
+		rs.texture = group.texture;
+		rs.blendMode = group.blendMode;
+		_target->draw(group.vertices.data(), group.vertices.size(), sf::Triangles, rs);
+		_frame.drawCalls++;
+		Totals.drawCalls++;
+
+		// Capacity is kept, next frames reuse the storage. //
+		group.vertices.clear();
+	}
+
+	_usedGroups = 0;
+	_lastGroup = 0;
+}
+
+SpriteBatch::Group& SpriteBatch::findGroup(const sf::Texture* texture, const sf::BlendMode& blendMode)
+{
+	// Consecutive sprites usually share their group. //
+	if (_lastGroup < _usedGroups)
+	{
+		Group& last = _groups[_lastGroup];
+		if (last.layer == _layer && last.texture == texture && last.blendMode == blendMode)
+			return last;
+	}
+
+	for (std::size_t i = 0; i < _usedGroups; ++i)
+	{
+		Group& group = _groups[i];
+		if (group.layer == _layer && group.texture == texture && group.blendMode == blendMode)
+			return _lastGroup = i, group;
+	}
+
+	if (_usedGroups == _groups.size())
+		_groups.emplace_back();
+
+	Group& group = _groups[_usedGroups];
+	group.layer = _layer;
+	group.texture = texture;
+	group.blendMode = blendMode;
+	group.order = _usedGroups;
+	_lastGroup = _usedGroups++;
+	return group;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "utils/rawtypes.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <vector>
+
+
+struct SpriteBatchStats
+{
+	Uint64 quads = 0;
+	Uint64 drawCalls = 0;
+};
+
+
+/*
+	Collects sprite quads, already transformed, per (layer, texture, blend mode) and draws every
+	group with a single call on flush. Lower layers are drawn first; inside a layer groups keep the
+	order of their first quad, so sprites of different textures that overlap must go to different layers.
+	While a Scope is open, AbstractSprite draws to its target are routed to the batch. Other drawables
+	are not deferred, flush() before drawing them on top of batched sprites.
+*/
+class SpriteBatch
+{
+public:
+	class Scope
+	{
+	private:
+		SpriteBatch& _batch;
+		SpriteBatch* _previous;
+
+	public:
+		Scope(SpriteBatch& batch, sf::RenderTarget& target);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope(Scope&&) noexcept = delete;
+
+		Scope& operator= (const Scope&) = delete;
+		Scope& operator= (Scope&&) noexcept = delete;
+	};
+
+private:
+	struct Group
+	{
+		int layer = 0;
+		const sf::Texture* texture = nullptr;
+		sf::BlendMode blendMode;
+		std::size_t order = 0;
+		std::vector<sf::Vertex> vertices;
+	};
+
+private:
+	static thread_local SpriteBatch* Current;
+
+	// Every batch of the thread adds up here, the controller resets it per snapshot. //
+	static thread_local SpriteBatchStats Totals;
+
+private:
+	sf::RenderTarget* _target = nullptr;
+	std::vector<Group> _groups;
+	std::size_t _usedGroups = 0;
+	std::size_t _lastGroup = 0;
+	std::vector<std::size_t> _drawOrder;
+	int _layer = 0;
+
+	SpriteBatchStats _frame;
+	SpriteBatchStats _last;
+
+public:
+	SpriteBatch() = default;
+	SpriteBatch(const SpriteBatch&) = delete;
+	SpriteBatch(SpriteBatch&&) noexcept = default;
+	~SpriteBatch() = default;
+
+	SpriteBatch& operator= (const SpriteBatch&) = delete;
+	SpriteBatch& operator= (SpriteBatch&&) noexcept = default;
+
+public:
+	// Quad in TriangleStrip order (top-left, bottom-left, top-right, bottom-right), as AbstractSprite stores it. //
+	void submit(const sf::Vertex (&quad)[4], const sf::RenderStates& rs);
+
+	void flush();
+
+	// Counters of the last closed scope. //
+	inline const SpriteBatchStats& getStats() const { return _last; }
+
+	constexpr int getLayer() const { return _layer; }
+	constexpr void setLayer(int layer) { _layer = layer; }
+
+	inline bool isTarget(const sf::RenderTarget& target) const { return _target == &target; }
+
+public:
+	static inline SpriteBatch* current() { return Current; }
+
+	// Quads are the draw calls the sprites would take unbatched, drawCalls the ones they took. //
+	static inline const SpriteBatchStats& totals() { return Totals; }
+	static inline void resetTotals() { Totals = {}; }
+
+private:
+	Group& findGroup(const sf::Texture* texture, const sf::BlendMode& blendMode);
+};
@@ -0,0 +1,199 @@
+#include "startup.h"
+
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <mutex>
+#include <thread>
+
+
+static constexpr std::string_view statusName(StartupTaskStatus status)
+{
+	switch (status)
+	{
+		case StartupTaskStatus::Done: return "done";
+		case StartupTaskStatus::Failed: return "failed";
+		case StartupTaskStatus::Skipped: return "skipped";
+		default: return "pending";
+	}
+}
+
+static constexpr std::string_view affinityName(StartupAffinity affinity)
+{
+	return affinity == StartupAffinity::Main ? "main" : "worker";
+}
+
+
+
+StartupGraph& StartupGraph::add(std::string_view name, std::initializer_list<std::string_view> dependencies, StartupAffinity affinity, Action action)
+{
+	Task task;
+	task.name = name;
+	task.affinity = affinity;
+	task.action = std::move(action);
+	for (const auto& dependency : dependencies)
+		task.dependencies.emplace_back(dependency);
+
+	_tasks.push_back(std::move(task));
+	return *this;
+}
+
+bool StartupGraph::run()
+{
+	const std::size_t count = _tasks.size();
+	std::vector<std::size_t> waiting(count, 0);
+	std::vector<std::vector<std::size_t>> dependents(count);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		_tasks[i].status = StartupTaskStatus::Pending;
+		for (const auto& dependency : _tasks[i].dependencies)
+		{
+			auto it = std::find_if(_tasks.begin(), _tasks.end(), [&dependency](const Task& task) { return task.name == dependency; });
+			if (it == _tasks.end())
+			{
+				logger::error("Startup: Task '{}' depends on unknown task '{}'.", _tasks[i].name, dependency);
+				return false;
+			}
+			dependents[std::size_t(it - _tasks.begin())].push_back(i);
+			waiting[i]++;
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::size_t> mainReady;
+	std::vector<std::jthread> workers;
+	std::size_t finished = 0;
+	std::size_t running = 0;
+	bool result = true;
+	sf::Clock clock;
+
+	// Called with the mutex held. Failures propagate as skips so every task still finishes. //
+	std::function<void(std::size_t)> finish;
+	std::function<void(std::size_t)> schedule;
+
+	finish = [&](std::size_t index) {
+		finished++;
+		if (_tasks[index].status != StartupTaskStatus::Done)
+			result = false;
+
+		for (std::size_t dependent : dependents[index])
+		{
+			if (_tasks[index].status != StartupTaskStatus::Done && _tasks[dependent].status == StartupTaskStatus::Pending)
+			{
+				_tasks[dependent].status = StartupTaskStatus::Skipped;
+				_tasks[dependent].start = _tasks[dependent].end = clock.getElapsedTime();
+			}
+
+			if (--waiting[dependent] == 0)
+			{
+				if (_tasks[dependent].status == StartupTaskStatus::Skipped)
+					finish(dependent);
+				else
+					schedule(dependent);
+			}
+		}
+	};
+
+	const auto execute = [&](std::size_t index) {
+		Task& task = _tasks[index];
+		task.start = clock.getElapsedTime();
+
+		bool ok = false;
+		try { ok = task.action(); }
+		catch (const std::exception& ex)
+		{
+			logger::error("Startup: Task '{}' threw: {}", task.name, ex.what());
+		}
+
+		std::scoped_lock lock(mutex);
+		task.end = clock.getElapsedTime();
+		task.status = ok ? StartupTaskStatus::Done : StartupTaskStatus::Failed;
+		running--;
+		finish(index);
+		condition.notify_all();
+	};
+
+	schedule = [&](std::size_t index) {
+		running++;
+		if (_tasks[index].affinity == StartupAffinity::Main)
+			mainReady.push_back(index);
+		else
+			workers.emplace_back([&execute, index]() { execute(index); });
+	};
+
+	{
+		std::scoped_lock lock(mutex);
+		for (std::size_t i = 0; i < count; ++i)
+			if (waiting[i] == 0)
+				schedule(i);
+	}
+
+	std::unique_lock lock(mutex);
+	while (finished < count)
+	{
+		if (!mainReady.empty())
+		{
+			const std::size_t index = mainReady.front();
+			mainReady.pop_front();
+
+			lock.unlock();
+			execute(index);
+			lock.lock();
+		}
+		else if (running == 0)
+		{
+			logger::error("Startup: Dependency cycle between the remaining {} tasks.", count - finished);
+			result = false;
+			break;
+		}
+		else condition.wait(lock);
+	}
+	lock.unlock();
+
+	workers.clear();
+	_total = clock.getElapsedTime();
+	return result;
+}
+
+void StartupGraph::printReport(std::ostream& os) const
+{
+	os << std::format("Startup: {:.1f} ms", _total.asMicroseconds() / 1000.f) << std::endl;
+	for (const auto& task : _tasks)
+	{
+		os << std::format("  {:<12} {:<6} {:>8.1f} -> {:>8.1f} ms  {:>8.1f} ms  {}",
+			task.name,
+			affinityName(task.affinity),
+			task.start.asMicroseconds() / 1000.f,
+			task.end.asMicroseconds() / 1000.f,
+			(task.end - task.start).asMicroseconds() / 1000.f,
+			statusName(task.status)
+		) << std::endl;
+	}
+}
+
+JsonValue StartupGraph::toJson() const
+{
+	JsonValue tasks = JsonArray();
+	for (const auto& task : _tasks)
+	{
+		tasks.push_back({
+			{ "name", task.name },
+			{ "thread", affinityName(task.affinity) },
+			{ "dependencies", task.dependencies },
+			{ "status", statusName(task.status) },
+			{ "start_ms", task.start.asMicroseconds() / 1000.0 },
+			{ "end_ms", task.end.asMicroseconds() / 1000.0 },
+			{ "duration_ms", (task.end - task.start).asMicroseconds() / 1000.0 }
+		});
+	}
+
+	return {
+		{ "total_ms", _total.asMicroseconds() / 1000.0 },
+		{ "tasks", std::move(tasks) }
+	};
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "utils/json.h"
+#include "utils/path.h"
+
+#include <SFML/System.hpp>
+
+#include <functional>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+enum class StartupAffinity
+{
+	Worker,
+	Main
+};
+
+enum class StartupTaskStatus
+{
+	Pending,
+	Done,
+	Failed,
+	Skipped
+};
+
+
+/*
+	Dependency ordered startup tasks. Worker tasks run concurrently on their own threads, Main tasks
+	run on the thread that calls run() (window, Lua and GL work). A failed task skips its dependents.
+*/
+class StartupGraph
+{
+public:
+	using Action = std::function<bool()>;
+
+	struct Task
+	{
+		std::string name;
+		std::vector<std::string> dependencies;
+		StartupAffinity affinity = StartupAffinity::Worker;
+		Action action;
+
+		StartupTaskStatus status = StartupTaskStatus::Pending;
+		sf::Time start;
+		sf::Time end;
+	};
+
+private:
+	std::vector<Task> _tasks;
+	sf::Time _total;
+
+public:
+	StartupGraph() = default;
+	StartupGraph(const StartupGraph&) = delete;
+	StartupGraph(StartupGraph&&) noexcept = default;
+	~StartupGraph() = default;
+
+	StartupGraph& operator= (const StartupGraph&) = delete;
+	StartupGraph& operator= (StartupGraph&&) noexcept = default;
+
+public:
+	StartupGraph& add(std::string_view name, std::initializer_list<std::string_view> dependencies, StartupAffinity affinity, Action action);
+
+	bool run();
+
+	void printReport(std::ostream& os) const;
+
+	JsonValue toJson() const;
+
+public:
+	inline const std::vector<Task>& getTasks() const { return _tasks; }
+	inline sf::Time getTotalTime() const { return _total; }
+
+	inline StartupGraph& add(std::string_view name, std::initializer_list<std::string_view> dependencies, Action action)
+	{
+		return add(name, dependencies, StartupAffinity::Worker, std::move(action));
+	}
+
+	inline void writeReport(const Path& path) const { json::write(path.string(), toJson()); }
+};
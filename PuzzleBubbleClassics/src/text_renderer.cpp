@@ -0,0 +1,453 @@
+#include "text_renderer.h"
+
+#include "font.h"
+#include "texture_atlas.h"
+
+#include "utils/logger.h"
+#include "utils/profiler.h"
+
+#include <format>
+#include <optional>
+
+
+BitmapFontManager BitmapFontManager::Instance;
+
+// Glyph quads sample one pixel around the glyph, as sf::Text does, so it is copied with it. //
+static constexpr int GlyphMargin = 1;
+
+static constexpr int MinPageSize = 128;
+static constexpr int MaxPageSize = 2048;
+
+
+struct DefaultBake
+{
+	std::string_view font;
+	Uint32 characterSize;
+	float outlineThickness;
+};
+
+static constexpr DefaultBake DefaultBakes[] = {
+	{ "bubble", 30, 1 },
+	{ "bubble2", 30, 1 },
+	{ "bubble2", 50, 1 },
+	{ "arial", 16, 0 },
+	{ "arial", 24, 0 }
+};
+
+
+static void appendGlyphQuad(std::vector<sf::Vertex>& vertices, const sf::Vector2f& position, const sf::FloatRect& bounds, const sf::IntRect& textureRect)
+{
+	static constexpr float Margin = float(GlyphMargin);
+
+	const float left = position.x + bounds.left - Margin;
+	const float top = position.y + bounds.top - Margin;
+	const float right = position.x + bounds.left + bounds.width + Margin;
+	const float bottom = position.y + bounds.top + bounds.height + Margin;
+
+	const float u1 = float(textureRect.left) - Margin;
+	const float v1 = float(textureRect.top) - Margin;
+	const float u2 = float(textureRect.left + textureRect.width) + Margin;
+	const float v2 = float(textureRect.top + textureRect.height) + Margin;
+
+	vertices.emplace_back(sf::Vector2f(left, top), sf::Color::White, sf::Vector2f(u1, v1));
+	vertices.emplace_back(sf::Vector2f(right, top), sf::Color::White, sf::Vector2f(u2, v1));
+	vertices.emplace_back(sf::Vector2f(left, bottom), sf::Color::White, sf::Vector2f(u1, v2));
+	vertices.emplace_back(sf::Vector2f(left, bottom), sf::Color::White, sf::Vector2f(u1, v2));
+	vertices.emplace_back(sf::Vector2f(right, top), sf::Color::White, sf::Vector2f(u2, v1));
+	vertices.emplace_back(sf::Vector2f(right, bottom), sf::Color::White, sf::Vector2f(u2, v2));
+}
+
+
+
+bool BitmapFont::bake(const sf::Font& font, Uint32 characterSize, float outlineThickness)
+{
+	PROFILE_ZONE("BitmapFont::bake");
+
+	// Font pages only grow, so the rectangles of the first glyphs stay valid while the rest are rasterized. //
+	std::array<sf::Glyph, CharacterCount> fill;
+	std::array<sf::Glyph, CharacterCount> outline;
+	for (Uint32 i = 0; i < CharacterCount; ++i)
+	{
+		fill[i] = font.getGlyph(FirstCharacter + i, characterSize, false, 0);
+		if (outlineThickness > 0)
+			outline[i] = font.getGlyph(FirstCharacter + i, characterSize, false, outlineThickness);
+	}
+	const sf::Image page = font.getTexture(characterSize).copyToImage();
+
+	std::vector<const sf::Glyph*> glyphs;
+	glyphs.reserve(CharacterCount * 2);
+	for (std::size_t i = 0; i < CharacterCount; ++i)
+	{
+		if (fill[i].textureRect.width > 0 && fill[i].textureRect.height > 0)
+			glyphs.push_back(&fill[i]);
+		if (outline[i].textureRect.width > 0 && outline[i].textureRect.height > 0)
+			glyphs.push_back(&outline[i]);
+	}
+	std::sort(glyphs.begin(), glyphs.end(), [](const sf::Glyph* left, const sf::Glyph* right) {
+		return left->textureRect.height > right->textureRect.height;
+	});
+
+	// Smallest square page that holds every glyph. //
+	std::vector<sf::Vector2i> positions(glyphs.size());
+	std::optional<AtlasPacker> packer;
+	for (int size = MinPageSize; size <= MaxPageSize && !packer.has_value(); size *= 2)
+	{
+		packer.emplace(size, size, 1);
+		for (std::size_t i = 0; i < glyphs.size(); ++i)
+		{
+			const auto position = packer->insert(glyphs[i]->textureRect.width + GlyphMargin * 2, glyphs[i]->textureRect.height + GlyphMargin * 2);
+			if (!position.has_value())
+			{
+				packer.reset();
+				break;
+			}
+			positions[i] = *position;
+		}
+	}
+
+	if (!packer.has_value())
+	{
+		logger::error("BitmapFont: Glyphs of size {} do not fit in a {}x{} texture.", characterSize, MaxPageSize, MaxPageSize);
+		return false;
+	}
+
+	const int width = packer->getWidth();
+	const int height = std::min(packer->getHeight(), packer->getUsedHeight());
+
+	sf::Image image;
+	image.create(Uint32(width), Uint32(height), sf::Color(255, 255, 255, 0));
+
+	std::array<sf::IntRect, CharacterCount> fillRects;
+	std::array<sf::IntRect, CharacterCount> outlineRects;
+	for (std::size_t i = 0; i < glyphs.size(); ++i)
+	{
+		const sf::IntRect& source = glyphs[i]->textureRect;
+		image.copy(page, Uint32(positions[i].x), Uint32(positions[i].y), {
+			source.left - GlyphMargin,
+			source.top - GlyphMargin,
+			source.width + GlyphMargin * 2,
+			source.height + GlyphMargin * 2
+		});
+
+		const sf::IntRect rect = { positions[i].x + GlyphMargin, positions[i].y + GlyphMargin, source.width, source.height };
+		if (glyphs[i] >= fill.data() && glyphs[i] < fill.data() + CharacterCount)
+			fillRects[std::size_t(glyphs[i] - fill.data())] = rect;
+		else
+			outlineRects[std::size_t(glyphs[i] - outline.data())] = rect;
+	}
+
+	if (!_texture.loadFromImage(image))
+	{
+		logger::error("BitmapFont: Cannot upload a {}x{} glyph texture.", width, height);
+		return false;
+	}
+	_texture.setSmooth(true);
+
+	for (std::size_t i = 0; i < CharacterCount; ++i)
+	{
+		_fill[i] = { fill[i].advance, fill[i].bounds, fillRects[i] };
+		_outline[i] = { outline[i].advance, outline[i].bounds, outlineRects[i] };
+	}
+
+	_kerning.resize(CharacterCount * CharacterCount);
+	for (Uint32 first = 0; first < CharacterCount; ++first)
+		for (Uint32 second = 0; second < CharacterCount; ++second)
+			_kerning[first * CharacterCount + second] = font.getKerning(FirstCharacter + first, FirstCharacter + second, characterSize);
+
+	_characterSize = characterSize;
+	_outlineThickness = outlineThickness;
+	_lineSpacing = font.getLineSpacing(characterSize);
+
+	clearRuns();
+	return true;
+}
+
+GlyphRun BitmapFont::layout(std::string_view text) const
+{
+	PROFILE_ZONE("BitmapFont::layout");
+
+	// Same metrics as sf::Text, so replaced texts keep their place. //
+	const float whitespaceWidth = _fill[' ' - FirstCharacter].advance;
+	const bool outlined = _outlineThickness > 0;
+
+	std::vector<sf::Vertex> fillVertices;
+	std::vector<sf::Vertex> outlineVertices;
+	fillVertices.reserve(text.size() * 6);
+	if (outlined)
+		outlineVertices.reserve(text.size() * 6);
+
+	float x = 0;
+	float y = float(_characterSize);
+	float minX = float(_characterSize);
+	float minY = float(_characterSize);
+	float maxX = 0;
+	float maxY = 0;
+	Uint32 previous = 0;
+
+	for (const char c : text)
+	{
+		const Uint32 current = Uint32(static_cast<unsigned char>(c));
+		if (current == '\r')
+			continue;
+
+		x += getKerning(previous, current);
+		previous = current;
+
+		if (current == ' ' || current == '\n' || current == '\t')
+		{
+			minX = std::min(minX, x);
+			minY = std::min(minY, y);
+
+			if (current == ' ')
+				x += whitespaceWidth;
+			else if (current == '\t')
+				x += whitespaceWidth * 4;
+			else
+				y += _lineSpacing, x = 0;
+
+			maxX = std::max(maxX, x);
+			maxY = std::max(maxY, y);
+			continue;
+		}
+
+		if (!isBaked(current))
+			continue;
+
+		const Glyph& glyph = _fill[current - FirstCharacter];
+		if (outlined)
+		{
+			const Glyph& outline = _outline[current - FirstCharacter];
+			if (outline.textureRect.width > 0)
+				appendGlyphQuad(outlineVertices, { x, y }, outline.bounds, outline.textureRect);
+		}
+		if (glyph.textureRect.width > 0)
+			appendGlyphQuad(fillVertices, { x, y }, glyph.bounds, glyph.textureRect);
+
+		minX = std::min(minX, x + glyph.bounds.left);
+		maxX = std::max(maxX, x + glyph.bounds.left + glyph.bounds.width);
+		minY = std::min(minY, y + glyph.bounds.top);
+		maxY = std::max(maxY, y + glyph.bounds.top + glyph.bounds.height);
+
+		x += glyph.advance;
+	}
+
+	if (outlined)
+	{
+		minX -= _outlineThickness;
+		maxX += _outlineThickness;
+		minY -= _outlineThickness;
+		maxY += _outlineThickness;
+	}
+
+	GlyphRun run;
+	run.outlineVertices = outlineVertices.size();
+	run.vertices = std::move(outlineVertices);
+	run.vertices.insert(run.vertices.end(), fillVertices.begin(), fillVertices.end());
+	run.bounds = text.empty() ? sf::FloatRect() : sf::FloatRect(minX, minY, maxX - minX, maxY - minY);
+	return run;
+}
+
+std::shared_ptr<const GlyphRun> BitmapFont::getRun(std::string_view text)
+{
+	std::scoped_lock lock(_mutex);
+
+	auto it = _runs.find(text);
+	if (it != _runs.end())
+	{
+		_stats.hits++;
+		it->second.lastUse = ++_useClock;
+		return it->second.run;
+	}
+
+	_stats.misses++;
+	while (_runs.size() >= _runCapacity)
+		evictOldestRun();
+
+	auto run = std::make_shared<const GlyphRun>(layout(text));
+	_runs.insert({ std::string(text), { run, ++_useClock } });
+	return run;
+}
+
+void BitmapFont::evictOldestRun()
+{
+	// Texts keep their run alive, so evicting never invalidates what is on screen. //
+	auto oldest = std::min_element(_runs.begin(), _runs.end(), [](const auto& left, const auto& right) {
+		return left.second.lastUse < right.second.lastUse;
+	});
+	if (oldest != _runs.end())
+	{
+		_runs.erase(oldest);
+		_stats.evictions++;
+	}
+}
+
+void BitmapFont::clearRuns()
+{
+	std::scoped_lock lock(_mutex);
+	_runs.clear();
+}
+
+
+
+
+std::string BitmapFontManager::makeId(std::string_view fontName, Uint32 characterSize, float outlineThickness)
+{
+	return std::format("{}@{}/{}", fontName, characterSize, outlineThickness);
+}
+
+BitmapFontManager::Pointer BitmapFontManager::bake(std::string_view fontName, Uint32 characterSize, float outlineThickness)
+{
+	const std::string id = makeId(fontName, characterSize, outlineThickness);
+
+	std::scoped_lock lock(_mutex);
+	if (Pointer ptr = get(id); ptr != nullptr)
+		return ptr;
+
+	const std::shared_ptr<sf::Font> font = FontManager::instance().get(fontName);
+	if (font == nullptr)
+	{
+		logger::error("BitmapFont: Font '{}' is not loaded.", fontName);
+		return nullptr;
+	}
+	return create(id, *font, characterSize, outlineThickness);
+}
+
+BitmapFontManager::Pointer BitmapFontManager::bake(std::string_view fontName, const sf::Font& font, Uint32 characterSize, float outlineThickness)
+{
+	const std::string id = makeId(fontName, characterSize, outlineThickness);
+
+	std::scoped_lock lock(_mutex);
+	if (Pointer ptr = get(id); ptr != nullptr)
+		return ptr;
+
+	return create(id, font, characterSize, outlineThickness);
+}
+
+BitmapFontManager::Pointer BitmapFontManager::create(const std::string& id, const sf::Font& font, Uint32 characterSize, float outlineThickness)
+{
+	Pointer ptr = emplace(id);
+	if (ptr == nullptr)
+		return nullptr;
+
+	if (!ptr->bake(font, characterSize, outlineThickness))
+	{
+		logger::error("BitmapFont: Cannot bake '{}'.", id);
+		destroy(id);
+		return nullptr;
+	}
+
+	// The texture had no size yet when it was stored. //
+	remeasure(id);
+
+	const sf::Vector2u size = ptr->getTexture().getSize();
+	logger::info("BitmapFont: Baked '{}' into a {}x{} texture.", id, size.x, size.y);
+	return ptr;
+}
+
+bool BitmapFontManager::bakeDefaults()
+{
+	PROFILE_ZONE("BitmapFontManager::bakeDefaults");
+
+	bool result = true;
+	for (const DefaultBake& entry : DefaultBakes)
+		if (bake(entry.font, entry.characterSize, entry.outlineThickness) == nullptr)
+			result = false;
+	return result;
+}
+
+std::size_t BitmapFontManager::measure(const std::string& id, const BitmapFont& font) const
+{
+	const sf::Vector2u size = font.getTexture().getSize();
+	return std::size_t(size.x) * size.y * 4;
+}
+
+
+
+
+void BitmapText::setFont(const std::shared_ptr<BitmapFont>& font)
+{
+	if (font == _font)
+		return;
+
+	_font = font;
+	refreshRun();
+}
+
+void BitmapText::setString(std::string_view string)
+{
+	if (string == _string)
+		return;
+
+	_string = string;
+	refreshRun();
+}
+
+void BitmapText::setFillColor(const sf::Color& color)
+{
+	if (color != _fillColor)
+		_fillColor = color, _colorsDirty = true;
+}
+
+void BitmapText::setOutlineColor(const sf::Color& color)
+{
+	if (color != _outlineColor)
+		_outlineColor = color, _colorsDirty = true;
+}
+
+void BitmapText::setAlpha(float alpha)
+{
+	alpha = std::clamp(alpha, 0.f, 1.f);
+	if (alpha != _alpha)
+		_alpha = alpha, _colorsDirty = true;
+}
+
+sf::FloatRect BitmapText::getLocalBounds() const
+{
+	return _run == nullptr ? sf::FloatRect() : _run->bounds;
+}
+
+void BitmapText::refreshRun()
+{
+	_run = _font == nullptr ? nullptr : _font->getRun(_string);
+	_geometryDirty = true;
+}
+
+void BitmapText::updateColors() const
+{
+	const auto modulate = [this](sf::Color color) {
+		color.a = Uint8(float(color.a) * _alpha);
+		return color;
+	};
+	const sf::Color fill = modulate(_fillColor);
+	const sf::Color outline = modulate(_outlineColor);
+
+	const std::size_t outlineVertices = std::min(_run->outlineVertices, _vertices.size());
+	for (std::size_t i = 0; i < outlineVertices; ++i)
+		_vertices[i].color = outline;
+	for (std::size_t i = outlineVertices; i < _vertices.size(); ++i)
+		_vertices[i].color = fill;
+
+	_colorsDirty = false;
+}
+
+void BitmapText::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	if (_font == nullptr || _run == nullptr)
+		return;
+
+	if (_geometryDirty)
+	{
+		_vertices.assign(_run->vertices.begin(), _run->vertices.end());
+		_geometryDirty = false;
+		_colorsDirty = true;
+	}
+	if (_colorsDirty)
+		updateColors();
+
+	if (_vertices.empty())
+		return;
+
+	states.transform *= getTransform();
+	states.texture = &_font->getTexture();
+	target.draw(_vertices.data(), _vertices.size(), sf::Triangles, states);
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "utils/manager.h"
+#include "utils/rawtypes.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+struct GlyphRunCacheStats
+{
+	Uint64 hits = 0;
+	Uint64 misses = 0;
+	Uint64 evictions = 0;
+};
+
+
+// Laid out text in local coordinates: outline quads first, fill quads after, all of them white. //
+struct GlyphRun
+{
+	std::vector<sf::Vertex> vertices;
+	std::size_t outlineVertices = 0;
+	sf::FloatRect bounds;
+};
+
+
+/*
+	Printable ASCII glyphs of a font rasterized once at a fixed size and outline, packed into a texture
+	of its own together with the kerning pairs. Laying out a string no longer touches the sf::Font, and
+	the runs of recently used strings are cached. Characters outside the baked range are skipped.
+*/
+class BitmapFont
+{
+public:
+	static constexpr Uint32 FirstCharacter = 32;
+	static constexpr Uint32 LastCharacter = 126;
+	static constexpr std::size_t CharacterCount = LastCharacter - FirstCharacter + 1;
+
+	static constexpr std::size_t DefaultRunCapacity = 256;
+
+private:
+	struct Glyph
+	{
+		float advance = 0;
+		sf::FloatRect bounds;
+		sf::IntRect textureRect;
+	};
+
+	struct CachedRun
+	{
+		std::shared_ptr<const GlyphRun> run;
+		Uint64 lastUse = 0;
+	};
+
+private:
+	sf::Texture _texture;
+	Uint32 _characterSize = 0;
+	float _outlineThickness = 0;
+	float _lineSpacing = 0;
+	std::array<Glyph, CharacterCount> _fill;
+	std::array<Glyph, CharacterCount> _outline;
+	std::vector<float> _kerning;
+
+	// Texts are updated on both the update and the render threads. //
+	mutable std::mutex _mutex;
+	std::unordered_map<std::string, CachedRun, utils::manager::StringHash, std::equal_to<>> _runs;
+	std::size_t _runCapacity = DefaultRunCapacity;
+	Uint64 _useClock = 0;
+	GlyphRunCacheStats _stats;
+
+public:
+	BitmapFont() = default;
+	BitmapFont(const BitmapFont&) = delete;
+	BitmapFont(BitmapFont&&) noexcept = delete;
+	~BitmapFont() = default;
+
+	BitmapFont& operator= (const BitmapFont&) = delete;
+	BitmapFont& operator= (BitmapFont&&) noexcept = delete;
+
+public:
+	// Needs a GL context. //
+	bool bake(const sf::Font& font, Uint32 characterSize, float outlineThickness);
+
+	// Cached run of the string, laid out on the first request. //
+	std::shared_ptr<const GlyphRun> getRun(std::string_view text);
+
+	GlyphRun layout(std::string_view text) const;
+
+	void clearRuns();
+
+public:
+	inline const sf::Texture& getTexture() const { return _texture; }
+	constexpr Uint32 getCharacterSize() const { return _characterSize; }
+	constexpr float getOutlineThickness() const { return _outlineThickness; }
+	constexpr float getLineSpacing() const { return _lineSpacing; }
+
+	constexpr std::size_t getRunCapacity() const { return _runCapacity; }
+	inline void setRunCapacity(std::size_t capacity) { std::scoped_lock lock(_mutex); _runCapacity = std::max<std::size_t>(capacity, 1); }
+
+	inline GlyphRunCacheStats getStats() const { std::scoped_lock lock(_mutex); return _stats; }
+
+private:
+	static constexpr bool isBaked(Uint32 character) { return character >= FirstCharacter && character <= LastCharacter; }
+
+	inline float getKerning(Uint32 first, Uint32 second) const
+	{
+		if (!isBaked(first) || !isBaked(second) || _kerning.empty())
+			return 0;
+		return _kerning[(first - FirstCharacter) * CharacterCount + (second - FirstCharacter)];
+	}
+
+	void evictOldestRun();
+};
+
+
+
+class BitmapFontManager : public Manager<BitmapFont>
+{
+private:
+	static BitmapFontManager Instance;
+
+private:
+	std::mutex _mutex;
+
+public:
+	// Returns the baked font, baking it on the first request. Needs a GL context. //
+	Pointer bake(std::string_view fontName, Uint32 characterSize, float outlineThickness = 0);
+	Pointer bake(std::string_view fontName, const sf::Font& font, Uint32 characterSize, float outlineThickness = 0);
+
+	// Sizes used by the game texts, once their fonts are loaded. //
+	bool bakeDefaults();
+
+private:
+	inline BitmapFontManager() : Manager(nullptr) {}
+
+	Pointer create(const std::string& id, const sf::Font& font, Uint32 characterSize, float outlineThickness);
+
+	std::size_t measure(const std::string& id, const BitmapFont& font) const override;
+
+	static std::string makeId(std::string_view fontName, Uint32 characterSize, float outlineThickness);
+
+public:
+	static constexpr BitmapFontManager& instance() { return Instance; }
+};
+
+
+
+/*
+	sf::Text replacement drawing from a baked font. Changing the string picks up a cached run, and
+	changing the colors or the alpha only rewrites the vertex colors on the next draw.
+*/
+class BitmapText : public sf::Drawable, public sf::Transformable
+{
+private:
+	std::shared_ptr<BitmapFont> _font;
+	std::shared_ptr<const GlyphRun> _run;
+	std::string _string;
+	sf::Color _fillColor = sf::Color::White;
+	sf::Color _outlineColor = sf::Color::Black;
+	float _alpha = 1;
+
+	mutable std::vector<sf::Vertex> _vertices;
+	mutable bool _geometryDirty = false;
+	mutable bool _colorsDirty = false;
+
+public:
+	BitmapText() = default;
+	BitmapText(const BitmapText&) = default;
+	BitmapText(BitmapText&&) noexcept = default;
+	~BitmapText() = default;
+
+	BitmapText& operator= (const BitmapText&) = default;
+	BitmapText& operator= (BitmapText&&) noexcept = default;
+
+public:
+	void setFont(const std::shared_ptr<BitmapFont>& font);
+	void setString(std::string_view string);
+
+	void setFillColor(const sf::Color& color);
+	void setOutlineColor(const sf::Color& color);
+
+	// Multiplies the alpha of both colors. //
+	void setAlpha(float alpha);
+
+	sf::FloatRect getLocalBounds() const;
+	inline sf::FloatRect getGlobalBounds() const { return getTransform().transformRect(getLocalBounds()); }
+
+public:
+	inline const std::shared_ptr<BitmapFont>& getFont() const { return _font; }
+	inline const std::string& getString() const { return _string; }
+	constexpr const sf::Color& getFillColor() const { return _fillColor; }
+	constexpr const sf::Color& getOutlineColor() const { return _outlineColor; }
+	constexpr float getAlpha() const { return _alpha; }
+
+protected:
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+	void refreshRun();
+	void updateColors() const;
+};
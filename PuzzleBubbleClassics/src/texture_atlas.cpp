@@ -0,0 +1,255 @@
+#include "texture_atlas.h"
+
+#include "utils/logger.h"
+#include "utils/profiler.h"
+
+#include <algorithm>
+#include <numeric>
+
+
+AtlasPacker::AtlasPacker(int width, int height, int padding) :
+	_width(width),
+	_height(height),
+	_padding(padding),
+	_skyline()
+{
+	reset();
+}
+
+void AtlasPacker::reset()
+{
+	_skyline.clear();
+	_skyline.push_back({ _padding, _padding, _width - _padding });
+	_usedArea = 0;
+}
+
+int AtlasPacker::getUsedHeight() const
+{
+	int height = _padding;
+	for (const Segment& segment : _skyline)
+		height = std::max(height, segment.y);
+	return height;
+}
+
+// Lowest y where a rectangle starting at segment 'index' fits, or -1. //
+int AtlasPacker::fit(std::size_t index, int width, int height) const
+{
+	const int x = _skyline[index].x;
+	if (x + width > _width)
+		return -1;
+
+	int y = _skyline[index].y;
+	for (int remaining = width; remaining > 0; ++index)
+	{
+		if (index >= _skyline.size())
+			return -1;
+
+		y = std::max(y, _skyline[index].y);
+		if (y + height > _height)
+			return -1;
+		remaining -= _skyline[index].width;
+	}
+	return y;
+}
+
+std::optional<sf::Vector2i> AtlasPacker::insert(int width, int height)
+{
+	const int paddedWidth = width + _padding;
+	const int paddedHeight = height + _padding;
+
+	std::size_t best = _skyline.size();
+	int bestBottom = _height + 1;
+	int bestWidth = _width + 1;
+	int bestY = 0;
+	for (std::size_t i = 0; i < _skyline.size(); ++i)
+	{
+		const int y = fit(i, paddedWidth, paddedHeight);
+		if (y < 0)
+			continue;
+
+		const int bottom = y + paddedHeight;
+		if (bottom < bestBottom || (bottom == bestBottom && _skyline[i].width < bestWidth))
+		{
+			best = i;
+			bestBottom = bottom;
+			bestWidth = _skyline[i].width;
+			bestY = y;
+		}
+	}
+
+	if (best == _skyline.size())
+		return {};
+
+	const sf::Vector2i position = { _skyline[best].x, bestY };
+	_skyline.insert(_skyline.begin() + best, Segment{ position.x, bestBottom, paddedWidth });
+
+	// Segments now covered by the new one are shortened or removed. //
+	for (std::size_t i = best + 1; i < _skyline.size();)
+	{
+		const Segment& previous = _skyline[i - 1];
+		const int overlap = previous.x + previous.width - _skyline[i].x;
+		if (overlap <= 0)
+			break;
+
+		_skyline[i].x += overlap;
+		_skyline[i].width -= overlap;
+		if (_skyline[i].width > 0)
+			break;
+		_skyline.erase(_skyline.begin() + i);
+	}
+
+	for (std::size_t i = 0; i + 1 < _skyline.size();)
+	{
+		if (_skyline[i].y == _skyline[i + 1].y)
+		{
+			_skyline[i].width += _skyline[i + 1].width;
+			_skyline.erase(_skyline.begin() + i + 1);
+		}
+		else ++i;
+	}
+
+	_usedArea += Uint64(paddedWidth) * Uint64(paddedHeight);
+	return position;
+}
+
+
+
+
+TextureAtlas::TextureAtlas(int pageSize) :
+	_pageSize(pageSize),
+	_pages(),
+	_placements()
+{}
+
+TextureAtlas::Page& TextureAtlas::newPage()
+{
+	Page& page = _pages.emplace_back(Page{ sf::Image(), AtlasPacker(_pageSize, _pageSize, Padding), nullptr });
+	page.image.create(Uint32(_pageSize), Uint32(_pageSize), sf::Color::Transparent);
+	return page;
+}
+
+void TextureAtlas::blit(sf::Image& target, const sf::Image& source, const sf::Vector2i& position) const
+{
+	const int width = int(source.getSize().x);
+	const int height = int(source.getSize().y);
+	const int extrude = Padding / 2;
+
+	target.copy(source, Uint32(position.x), Uint32(position.y));
+	if (extrude <= 0)
+		return;
+
+	// Edge pixels are repeated around the image, corners included. //
+	for (int y = -extrude; y < height + extrude; ++y)
+	{
+		const int sy = std::clamp(y, 0, height - 1);
+		for (int x = -extrude; x < width + extrude; ++x)
+		{
+			if (x >= 0 && x < width && y >= 0 && y < height)
+			{
+				x = width - 1;
+				continue;
+			}
+
+			const int sx = std::clamp(x, 0, width - 1);
+			target.setPixel(Uint32(position.x + x), Uint32(position.y + y), source.getPixel(Uint32(sx), Uint32(sy)));
+		}
+	}
+}
+
+std::size_t TextureAtlas::pack(const std::vector<TextureAtlasImage>& images)
+{
+	PROFILE_ZONE("TextureAtlas::pack");
+
+	std::vector<std::size_t> order(images.size());
+	std::iota(order.begin(), order.end(), std::size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&images](std::size_t left, std::size_t right) {
+		const sf::Vector2u& l = images[left].image.getSize();
+		const sf::Vector2u& r = images[right].image.getSize();
+		return l.y != r.y ? l.y > r.y : l.x > r.x;
+	});
+
+	std::size_t placed = 0;
+	for (std::size_t index : order)
+	{
+		const TextureAtlasImage& entry = images[index];
+		const sf::Vector2u size = entry.image.getSize();
+		if (!canPack(size, _pageSize) || _placements.contains(entry.key))
+			continue;
+
+		std::optional<sf::Vector2i> position;
+		std::size_t pageIndex = 0;
+		for (; pageIndex < _pages.size() && !position.has_value(); ++pageIndex)
+			position = _pages[pageIndex].packer.insert(int(size.x), int(size.y));
+
+		if (position.has_value())
+			pageIndex--;
+		else
+		{
+			pageIndex = _pages.size();
+			position = newPage().packer.insert(int(size.x), int(size.y));
+			if (!position.has_value())
+				continue;
+		}
+
+		Page& page = _pages[pageIndex];
+		blit(page.image, entry.image, *position);
+		_placements.insert_or_assign(entry.key, Placement{ pageIndex, { position->x, position->y, int(size.x), int(size.y) } });
+		placed++;
+	}
+
+	return placed;
+}
+
+bool TextureAtlas::upload()
+{
+	PROFILE_ZONE("TextureAtlas::upload");
+
+	bool result = true;
+	for (std::size_t i = 0; i < _pages.size(); ++i)
+	{
+		Page& page = _pages[i];
+		if (page.texture != nullptr)
+			continue;
+
+		const int height = std::min(_pageSize, page.packer.getUsedHeight());
+		auto texture = std::make_shared<sf::Texture>();
+		if (!texture->loadFromImage(page.image, { 0, 0, _pageSize, height }))
+		{
+			logger::error("TextureAtlas: Cannot upload page {} ({}x{}).", i, _pageSize, height);
+			result = false;
+			continue;
+		}
+
+		page.texture = std::move(texture);
+		page.image = sf::Image();
+	}
+	return result;
+}
+
+std::optional<TextureRegion> TextureAtlas::find(std::string_view key) const
+{
+	auto it = _placements.find(std::string(key));
+	if (it == _placements.end())
+		return {};
+
+	const Page& page = _pages[it->second.page];
+	if (page.texture == nullptr)
+		return {};
+	return TextureRegion{ page.texture, it->second.rect };
+}
+
+void TextureAtlas::forEachRegion(const std::function<void(const std::string&, const TextureRegion&)>& action) const
+{
+	for (const auto& [key, placement] : _placements)
+	{
+		const Page& page = _pages[placement.page];
+		if (page.texture != nullptr)
+			action(key, TextureRegion{ page.texture, placement.rect });
+	}
+}
+
+void TextureAtlas::clear()
+{
+	_pages.clear();
+	_placements.clear();
+}
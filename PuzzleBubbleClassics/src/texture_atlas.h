@@ -0,0 +1,155 @@
+#pragma once
+
+#include "utils/rawtypes.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+// Texture plus the area of it that belongs to one image. Standalone textures cover their whole size. //
+struct TextureRegion
+{
+	std::shared_ptr<sf::Texture> texture = nullptr;
+	sf::IntRect rect = {};
+
+	inline bool isValid() const { return texture != nullptr; }
+};
+
+
+/*
+	Skyline bottom-left rectangle packer. Every rectangle reserves 'padding' extra pixels on its right
+	and bottom sides, and the page keeps the same margin on its top and left sides.
+*/
+class AtlasPacker
+{
+private:
+	struct Segment
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+private:
+	int _width;
+	int _height;
+	int _padding;
+	std::vector<Segment> _skyline;
+	Uint64 _usedArea = 0;
+
+public:
+	AtlasPacker(int width, int height, int padding);
+	AtlasPacker(const AtlasPacker&) = default;
+	AtlasPacker(AtlasPacker&&) noexcept = default;
+	~AtlasPacker() = default;
+
+	AtlasPacker& operator= (const AtlasPacker&) = default;
+	AtlasPacker& operator= (AtlasPacker&&) noexcept = default;
+
+public:
+	std::optional<sf::Vector2i> insert(int width, int height);
+
+	void reset();
+
+	// Lowest row below every placed rectangle, padding included. //
+	int getUsedHeight() const;
+
+public:
+	constexpr int getWidth() const { return _width; }
+	constexpr int getHeight() const { return _height; }
+
+	inline float getOccupancy() const { return float(_usedArea) / (float(_width) * float(_height)); }
+
+private:
+	int fit(std::size_t index, int width, int height) const;
+};
+
+
+
+struct TextureAtlasImage
+{
+	std::string key;
+	sf::Image image;
+};
+
+
+/*
+	Pages of small images packed together so sprites of different images can share a draw call.
+	pack() only touches images and may run on any thread; upload() creates the textures and needs a
+	GL context. Images bigger than MaxEntrySize stay out of the atlas.
+*/
+class TextureAtlas
+{
+public:
+	static constexpr int DefaultPageSize = 2048;
+	static constexpr int MaxEntrySize = 512;
+
+	// Half of the padding is filled with the image edges, so linear filtering never samples a neighbour. //
+	static constexpr int Padding = 2;
+
+private:
+	struct Page
+	{
+		sf::Image image;
+		AtlasPacker packer;
+		std::shared_ptr<sf::Texture> texture;
+	};
+
+	struct Placement
+	{
+		std::size_t page;
+		sf::IntRect rect;
+	};
+
+private:
+	int _pageSize;
+	std::vector<Page> _pages;
+	std::unordered_map<std::string, Placement> _placements;
+
+public:
+	explicit TextureAtlas(int pageSize = DefaultPageSize);
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas(TextureAtlas&&) noexcept = default;
+	~TextureAtlas() = default;
+
+	TextureAtlas& operator= (const TextureAtlas&) = delete;
+	TextureAtlas& operator= (TextureAtlas&&) noexcept = default;
+
+public:
+	// Places the biggest images first. Returns how many images were placed. //
+	std::size_t pack(const std::vector<TextureAtlasImage>& images);
+
+	// Pages are cropped to their used height; the pixels are released once uploaded. //
+	bool upload();
+
+	std::optional<TextureRegion> find(std::string_view key) const;
+
+	// Only uploaded pages are visited. //
+	void forEachRegion(const std::function<void(const std::string&, const TextureRegion&)>& action) const;
+
+	void clear();
+
+public:
+	inline bool isEmpty() const { return _placements.empty(); }
+	inline std::size_t getPageCount() const { return _pages.size(); }
+	inline std::size_t getEntryCount() const { return _placements.size(); }
+
+	static constexpr bool canPack(const sf::Vector2u& size, int pageSize = DefaultPageSize)
+	{
+		return size.x > 0 && size.y > 0
+			&& int(size.x) <= MaxEntrySize && int(size.y) <= MaxEntrySize
+			&& int(size.x) + Padding * 2 <= pageSize && int(size.y) + Padding * 2 <= pageSize;
+	}
+
+private:
+	Page& newPage();
+
+	void blit(sf::Image& target, const sf::Image& source, const sf::Vector2i& position) const;
+};
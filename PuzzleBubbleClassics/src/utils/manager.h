@@ -1,11 +1,56 @@
 #pragma once
 
+#include <algorithm>
 #include <concepts>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <list>
 #include <memory>
+#include <vector>
 
 #include "reference.h"
+#include "rawtypes.h"
+
+
+struct ResidencyStats
+{
+	Uint64 hits = 0;
+	Uint64 misses = 0;
+	Uint64 evictions = 0;
+	Uint64 reloads = 0;
+	std::size_t residentBytes = 0;
+	std::size_t budget = 0;
+};
+
+
+namespace utils::manager
+{
+	template <typename _IdTy>
+	struct KeyTraits
+	{
+		using Hash = std::hash<_IdTy>;
+		using Equal = std::equal_to<_IdTy>;
+		using View = const _IdTy&;
+	};
+
+	// String ids are looked up through string_view so literals and views never allocate. //
+	struct StringHash
+	{
+		using is_transparent = void;
+
+		inline std::size_t operator() (std::string_view str) const noexcept { return std::hash<std::string_view>{}(str); }
+	};
+
+	template <>
+	struct KeyTraits<std::string>
+	{
+		using Hash = StringHash;
+		using Equal = std::equal_to<>;
+		using View = std::string_view;
+	};
+}
 
 
 template <typename _Ty, typename _IdTy = std::string> requires
@@ -16,12 +61,78 @@ class Manager
 public:
 	using ValueType = _Ty;
 	using IdType = _IdTy;
+	using IdView = typename utils::manager::KeyTraits<IdType>::View;
 	using Pointer = std::shared_ptr<ValueType>;
 	using ConstPointer = std::shared_ptr<const ValueType>;
 
+	static constexpr std::size_t UnlimitedBudget = 0;
+
+public:
+	/*
+		Resolve-once reference to an entry. Handles go stale when their entry is destroyed, replaced
+		or evicted; get() then returns null and the id has to be resolved again.
+	*/
+	class Handle
+	{
+	private:
+		static constexpr Uint32 InvalidIndex = Uint32(-1);
+
+		friend Manager;
+
+	private:
+		Uint32 _index = InvalidIndex;
+		Uint32 _generation = 0;
+
+	public:
+		constexpr Handle() noexcept = default;
+		constexpr Handle(const Handle&) noexcept = default;
+		constexpr Handle(Handle&&) noexcept = default;
+		constexpr ~Handle() noexcept = default;
+
+		constexpr Handle& operator= (const Handle&) noexcept = default;
+		constexpr Handle& operator= (Handle&&) noexcept = default;
+
+		constexpr bool operator== (const Handle&) const noexcept = default;
+
+	private:
+		constexpr Handle(Uint32 index, Uint32 generation) noexcept : _index(index), _generation(generation) {}
+
+	public:
+		constexpr bool isNull() const noexcept { return _index == InvalidIndex; }
+	};
+
+private:
+	using Hash = typename utils::manager::KeyTraits<IdType>::Hash;
+	using Equal = typename utils::manager::KeyTraits<IdType>::Equal;
+	using LruList = std::list<Uint32>;
+
+	struct Slot
+	{
+		IdType id;
+		Pointer ptr;
+		typename LruList::iterator lru;
+		Uint32 generation = 0;
+
+		// Measured when stored or remeasured, never on lookups or trims. //
+		std::size_t bytes = 0;
+	};
+
 private:
 	Manager* _parent;
-	std::unordered_map<IdType, Pointer> _cache;
+	std::unordered_map<IdType, Uint32, Hash, Equal> _cache;
+	std::vector<Slot> _slots;
+	std::vector<Uint32> _freeSlots;
+
+	// Front is the most recently used slot. //
+	mutable LruList _lru;
+	std::unordered_set<IdType, Hash, Equal> _evicted;
+	std::size_t _budget = UnlimitedBudget;
+	std::size_t _residentBytes = 0;
+
+	mutable Uint64 _hits = 0;
+	mutable Uint64 _misses = 0;
+	Uint64 _evictions = 0;
+	Uint64 _reloads = 0;
 
 protected:
 	inline Manager(Manager* parent) :
@@ -40,7 +151,7 @@ public:
 	inline const std::shared_ptr<const Manager>& parent() const { return _parent; }
 	inline bool hasParent() const { return _parent != nullptr; }
 
-	inline bool contains(const IdType& id) const
+	inline bool contains(IdView id) const
 	{
 		if (_cache.contains(id))
 			return true;
@@ -48,35 +159,161 @@ public:
 		return hasParent() && _parent->contains(id);
 	}
 
-	inline Pointer get(const IdType& id)
+	/*
+		Without a budget lookups only read, so any thread may call get() while nothing is loaded or
+		destroyed. With a budget every lookup moves its entry in the LRU list and counts hits and misses,
+		get() is then restricted to the thread that owns the manager.
+	*/
+	inline Pointer get(IdView id)
 	{
 		auto it = _cache.find(id);
 		if (it != _cache.end())
-			return it->second;
+			return touch(_slots[it->second]);
+
+		countMiss();
+		if (auto evicted = _evicted.find(id); evicted != _evicted.end())
+		{
+			const IdType key = *evicted;
+			_evicted.erase(evicted);
+			if (Pointer ptr = reload(key); ptr != nullptr)
+			{
+				_reloads++;
+				return ptr;
+			}
+		}
 
 		if (!hasParent())
 			return {};
 		return _parent->get(id);
 	}
 
-	inline ConstPointer get(const IdType& id) const
+	inline ConstPointer get(IdView id) const
 	{
 		auto it = _cache.find(id);
 		if (it != _cache.end())
-			return it->second;
+			return touch(_slots[it->second]);
 
+		countMiss();
 		if (!hasParent())
 			return {};
 		return const_cast<const Manager*>(_parent)->get(id);
 	}
 
-	inline void destroy(const IdType& id)
+	// Handles only refer to entries of this manager, parents are not searched. //
+	inline Handle resolve(IdView id)
+	{
+		if (!_cache.contains(id) && get(id) == nullptr)
+			return {};
+
+		auto it = _cache.find(id);
+		if (it == _cache.end())
+			return {};
+		return { it->second, _slots[it->second].generation };
+	}
+
+	inline Pointer get(Handle handle)
+	{
+		if (!isValid(handle))
+			return {};
+		return touch(_slots[handle._index]);
+	}
+
+	inline ConstPointer get(Handle handle) const
+	{
+		if (!isValid(handle))
+			return {};
+		return touch(_slots[handle._index]);
+	}
+
+	inline bool isValid(Handle handle) const
+	{
+		return handle._index < _slots.size()
+			&& _slots[handle._index].generation == handle._generation
+			&& _slots[handle._index].ptr != nullptr;
+	}
+
+	inline void destroy(IdView id)
 	{
-		_cache.erase(id);
+		auto it = _cache.find(id);
+		if (it != _cache.end())
+		{
+			releaseSlot(it->second);
+			_cache.erase(it);
+		}
+
+		if (auto evicted = _evicted.find(id); evicted != _evicted.end())
+			_evicted.erase(evicted);
 	}
 
-	virtual inline void clear() { _cache.clear(); }
+	virtual inline void clear()
+	{
+		for (const auto& entry : _cache)
+			releaseSlot(entry.second);
+		_cache.clear();
+		_evicted.clear();
+	}
 
+public:
+	constexpr std::size_t getBudget() const { return _budget; }
+
+	// Budget in bytes, as reported by measure(). UnlimitedBudget keeps every entry resident. Set from the --budget option. //
+	inline void setBudget(std::size_t bytes)
+	{
+		_budget = bytes;
+		trim();
+	}
+
+	constexpr std::size_t getResidentBytes() const { return _residentBytes; }
+
+	inline ResidencyStats getResidencyStats() const
+	{
+		return { _hits, _misses, _evictions, _reloads, getResidentBytes(), _budget };
+	}
+
+	/*
+		Evicts least recently used entries until the budget is met. Entries still referenced
+		outside the manager are never evicted; evicted ids are reloaded on demand by get().
+	*/
+	void trim()
+	{
+		if (_budget == UnlimitedBudget)
+			return;
+
+		for (auto it = _lru.end(); _residentBytes > _budget && it != _lru.begin();)
+		{
+			--it;
+			const Uint32 index = *it;
+			const Slot& slot = _slots[index];
+			if (slot.bytes == 0 || slot.ptr.use_count() > 1)
+				continue;
+
+			++it;
+			_evicted.insert(slot.id);
+			_evictions++;
+			_cache.erase(slot.id);
+			releaseSlot(index);
+		}
+	}
+
+protected:
+	// Entries measured as zero bytes are never evicted. //
+	virtual inline std::size_t measure(const IdType&, const ValueType&) const { return 0; }
+
+	virtual inline Pointer reload(const IdType&) { return nullptr; }
+
+	// For entries that only get their size after being stored, like textures loaded in place. //
+	inline void remeasure(IdView id)
+	{
+		auto it = _cache.find(id);
+		if (it == _cache.end())
+			return;
+
+		Slot& slot = _slots[it->second];
+		_residentBytes -= slot.bytes;
+		slot.bytes = measure(slot.id, *slot.ptr);
+		_residentBytes += slot.bytes;
+		trim();
+	}
 
 protected:
 	template <typename _ObjTy = _Ty, typename... _ArgTys> requires
@@ -84,9 +321,78 @@ protected:
 		std::constructible_from<_ObjTy, _ArgTys...>
 		inline Pointer emplace(const IdType& id, _ArgTys&&... args)
 	{
-		auto res = _cache.insert({ id, std::make_shared<_ObjTy>(std::forward<_ArgTys>(args)...) });
-		if (!res.second)
+		if (_cache.contains(id))
+			return {};
+
+		Pointer ptr = std::make_shared<_ObjTy>(std::forward<_ArgTys>(args)...);
+		store(id, ptr);
+		return ptr;
+	}
+
+	inline Pointer insert(const IdType& id, const Pointer& ptr)
+	{
+		if (ptr == nullptr)
 			return {};
-		return res.first->second;
+
+		destroy(id);
+		store(id, ptr);
+		return ptr;
+	}
+
+private:
+	inline void store(const IdType& id, const Pointer& ptr)
+	{
+		Uint32 index;
+		if (_freeSlots.empty())
+		{
+			index = Uint32(_slots.size());
+			_slots.emplace_back();
+		}
+		else
+		{
+			index = _freeSlots.back();
+			_freeSlots.pop_back();
+		}
+
+		Slot& slot = _slots[index];
+		slot.id = id;
+		slot.ptr = ptr;
+		slot.bytes = measure(id, *ptr);
+		_residentBytes += slot.bytes;
+		_lru.push_front(index);
+		slot.lru = _lru.begin();
+
+		_cache.insert({ id, index });
+		if (auto evicted = _evicted.find(id); evicted != _evicted.end())
+			_evicted.erase(evicted);
+		trim();
+	}
+
+	inline void releaseSlot(Uint32 index)
+	{
+		Slot& slot = _slots[index];
+		_lru.erase(slot.lru);
+		_residentBytes -= slot.bytes;
+		slot.bytes = 0;
+		slot.ptr = nullptr;
+		slot.generation++;
+		_freeSlots.push_back(index);
+	}
+
+	// Recency is only tracked under a budget, entries keep their load order until one is set. //
+	inline const Pointer& touch(const Slot& slot) const
+	{
+		if (_budget != UnlimitedBudget)
+		{
+			_hits++;
+			_lru.splice(_lru.begin(), _lru, slot.lru);
+		}
+		return slot.ptr;
+	}
+
+	inline void countMiss() const
+	{
+		if (_budget != UnlimitedBudget)
+			_misses++;
 	}
 };
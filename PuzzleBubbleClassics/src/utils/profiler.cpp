@@ -0,0 +1,99 @@
+#include "profiler.h"
+
+#include "logger.h"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace profiler
+{
+	/*
+		Buffers are never freed: traces still show threads that already ended, and threads that
+		outlive static destruction (workers stopped from other singletons) can keep recording.
+	*/
+	static std::mutex& BuffersMutex = *new std::mutex();
+	static std::vector<std::unique_ptr<ThreadBuffer>>& Buffers = *new std::vector<std::unique_ptr<ThreadBuffer>>();
+
+
+	ThreadBuffer::ThreadBuffer(Uint32 id) :
+		_slots(),
+		_head(0),
+		_name(),
+		_id(id)
+	{}
+
+	ThreadBuffer& threadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			std::scoped_lock lock(BuffersMutex);
+			Buffers.push_back(std::make_unique<ThreadBuffer>(Uint32(Buffers.size() + 1)));
+			buffer = Buffers.back().get();
+		}
+		return *buffer;
+	}
+
+	void setThreadName(std::string_view name)
+	{
+		ThreadBuffer& buffer = threadBuffer();
+		std::scoped_lock lock(BuffersMutex);
+		buffer.setName(name);
+	}
+
+	static void writeEscaped(std::ostream& os, std::string_view str)
+	{
+		for (char c : str)
+		{
+			if (c == '"' || c == '\\')
+				os << '\\' << c;
+			else if (static_cast<unsigned char>(c) >= 0x20)
+				os << c;
+		}
+	}
+
+	bool writeChromeTrace(const Path& path)
+	{
+		std::ofstream os(path);
+		if (!os)
+		{
+			logger::error("Profiler: Cannot write trace to '{}'.", path.string());
+			return false;
+		}
+
+		os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+
+		std::scoped_lock lock(BuffersMutex);
+		for (const auto& buffer : Buffers)
+		{
+			if (!buffer->getName().empty())
+			{
+				os << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->getId() << ",\"args\":{\"name\":\"";
+				writeEscaped(os, buffer->getName());
+				os << "\"}}";
+				first = false;
+			}
+
+			const Uint64 head = buffer->getHead();
+			const Uint64 begin = head > ThreadBuffer::Capacity ? head - ThreadBuffer::Capacity : 0;
+			ZoneEvent event;
+			for (Uint64 i = begin; i < head; ++i)
+			{
+				if (!buffer->read(i, event))
+					continue;
+
+				os << (first ? "" : ",") << "\n{\"name\":\"";
+				writeEscaped(os, event.name);
+				os << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->getId() << ",\"ts\":" << event.begin << ",\"dur\":" << (event.end - event.begin) << '}';
+				first = false;
+			}
+		}
+
+		os << "\n]}\n";
+		return true;
+	}
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "rawtypes.h"
+#include "path.h"
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <string_view>
+
+// Builds that define PBC_PROFILER as 0 compile every zone out. //
+#ifndef PBC_PROFILER
+#define PBC_PROFILER 1
+#endif
+
+
+namespace profiler
+{
+	struct ZoneEvent
+	{
+		std::string_view name;
+		Int64 begin = 0;
+		Int64 end = 0;
+	};
+
+
+	/*
+		Ring of the latest zones of one thread. Only the owner thread writes. Every slot is guarded by
+		a sequence number, odd while it is written and 2 * (index + 1) once event 'index' is stored,
+		so readers on other threads skip the slots overwritten while they copy them.
+	*/
+	class ThreadBuffer
+	{
+	public:
+		static constexpr std::size_t Capacity = 1 << 15;
+
+	private:
+		// Fields are relaxed atomics, a torn read is only discarded, never a data race. //
+		struct Slot
+		{
+			std::atomic<Uint64> sequence = 0;
+			std::atomic<const char*> name = nullptr;
+			std::atomic<std::size_t> nameSize = 0;
+			std::atomic<Int64> begin = 0;
+			std::atomic<Int64> end = 0;
+		};
+
+	private:
+		std::array<Slot, Capacity> _slots;
+		std::atomic<Uint64> _head = 0;
+		std::string_view _name;
+		Uint32 _id;
+
+	public:
+		explicit ThreadBuffer(Uint32 id);
+		ThreadBuffer(const ThreadBuffer&) = delete;
+		ThreadBuffer(ThreadBuffer&&) noexcept = delete;
+		~ThreadBuffer() = default;
+
+		ThreadBuffer& operator= (const ThreadBuffer&) = delete;
+		ThreadBuffer& operator= (ThreadBuffer&&) noexcept = delete;
+
+	public:
+		inline void push(const ZoneEvent& event)
+		{
+			const Uint64 head = _head.load(std::memory_order_relaxed);
+			Slot& slot = _slots[head % Capacity];
+
+			slot.sequence.store(head * 2 + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.name.store(event.name.data(), std::memory_order_relaxed);
+			slot.nameSize.store(event.name.size(), std::memory_order_relaxed);
+			slot.begin.store(event.begin, std::memory_order_relaxed);
+			slot.end.store(event.end, std::memory_order_relaxed);
+			slot.sequence.store(head * 2 + 2, std::memory_order_release);
+
+			_head.store(head + 1, std::memory_order_release);
+		}
+
+		inline Uint64 getHead() const { return _head.load(std::memory_order_acquire); }
+
+		// False when event 'index' was overwritten before or while it was copied. //
+		inline bool read(Uint64 index, ZoneEvent& event) const
+		{
+			const Slot& slot = _slots[index % Capacity];
+			const Uint64 stored = index * 2 + 2;
+			if (slot.sequence.load(std::memory_order_acquire) != stored)
+				return false;
+
+			event.name = { slot.name.load(std::memory_order_relaxed), slot.nameSize.load(std::memory_order_relaxed) };
+			event.begin = slot.begin.load(std::memory_order_relaxed);
+			event.end = slot.end.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return slot.sequence.load(std::memory_order_relaxed) == stored;
+		}
+
+		constexpr Uint32 getId() const { return _id; }
+		constexpr std::string_view getName() const { return _name; }
+		constexpr void setName(std::string_view name) { _name = name; }
+	};
+
+
+	namespace detail
+	{
+		inline std::atomic<bool> Enabled = true;
+	}
+
+	inline bool isEnabled() { return detail::Enabled.load(std::memory_order_relaxed); }
+	inline void setEnabled(bool enabled) { detail::Enabled.store(enabled, std::memory_order_relaxed); }
+
+	// Microseconds since the profiler epoch. //
+	inline Int64 now()
+	{
+		static const auto epoch = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	ThreadBuffer& threadBuffer();
+
+	// Name shown for the calling thread in traces. Must outlive the profiler (a literal). //
+	void setThreadName(std::string_view name);
+
+	// Chrome Trace Event JSON, loadable in chrome://tracing or Perfetto. //
+	bool writeChromeTrace(const Path& path);
+
+
+	class Zone
+	{
+	private:
+		std::string_view _name;
+		Int64 _begin;
+
+	public:
+		inline explicit Zone(std::string_view name) : _name(name), _begin(isEnabled() ? now() : -1) {}
+		inline ~Zone()
+		{
+			if (_begin >= 0)
+				threadBuffer().push({ _name, _begin, now() });
+		}
+
+		Zone(const Zone&) = delete;
+		Zone(Zone&&) noexcept = delete;
+
+		Zone& operator= (const Zone&) = delete;
+		Zone& operator= (Zone&&) noexcept = delete;
+	};
+}
+
+
+#define PBC_PROFILE_CONCAT_IMPL(a, b) a##b
+#define PBC_PROFILE_CONCAT(a, b) PBC_PROFILE_CONCAT_IMPL(a, b)
+
+#if PBC_PROFILER
+#define PROFILE_ZONE(name) ::profiler::Zone PBC_PROFILE_CONCAT(_profileZone, __LINE__){ name }
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_THREAD(name) ::profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
@@ -2,6 +2,7 @@
 
 #include <random>
 #include <concepts>
+#include <sstream>
 #include <vector>
 
 
@@ -43,8 +44,9 @@ public:
 
 	inline float randomFloat()
 	{
+		// Divided as floating point, an integer division is always zero. //
 		const ResultType full = _max - _min;
-		return static_cast<float>((_rand() % full) / full);
+		return static_cast<float>(static_cast<double>(_rand() % full) / static_cast<double>(full));
 	}
 
 	inline SeedType randomSeed(ResultType min, ResultType max) { return static_cast<SeedType>((*this)(min, max)); }
@@ -75,6 +77,15 @@ public:
 	constexpr ResultType min() { return _min; }
 	constexpr ResultType max() { return _max; }
 
+	// Engine state, restoring it with setState() resumes the exact same sequence. //
+	inline SeedType getState() const
+	{
+		std::ostringstream os;
+		os << _rand;
+		return static_cast<SeedType>(std::stoull(os.str()));
+	}
+	inline void setState(SeedType state) { _rand.seed(state); }
+
 public:
 	template<typename _Ty, typename _ContainerTy> requires requires(_ContainerTy& cnt, std::size_t index)
 	{